@@ -10,6 +10,7 @@
 #include "symtab.h"
 #include "analyze.h"
 #include "util.h"
+#include "intern.h"
 
 static Scope globalScope = NULL;
 static char * scopeName;
@@ -46,7 +47,7 @@ static void insertIOFunc(void)
   func->type = Void;
 
   param = newParamNode(NonArrParamK);
-  param->attr.name = "arg";
+  param->attr.name = internString("arg");
   param->type = Integer;
   param->child[0] = newTypeNode(FuncK);
   param->child[0]->attr.type = INT;
@@ -56,16 +57,16 @@ static void insertIOFunc(void)
   compStmt->child[1] = NULL;      
 
   func->lineno = 0;
-  func->attr.name = "output";
+  func->attr.name = internString("output");
   func->child[0] = typeSpec;
   func->child[1] = param;
   func->child[2] = compStmt;
 
-  st_insert("output", 0, func);
+  st_insert(func->attr.name, 0, func);
 
   Scope s = scope_create("output");
   scope_push(s);
-  st_insert("arg", 0, param);
+  st_insert(param->attr.name, 0, param);
   scope_pop(-1);
 
 
@@ -80,12 +81,12 @@ static void insertIOFunc(void)
   compStmt->child[1] = NULL;      
 
   func->lineno = 0;
-  func->attr.name = "input";
+  func->attr.name = internString("input");
   func->child[0] = typeSpec;
   func->child[1] = NULL;          
   func->child[2] = compStmt;
 
-  st_insert("input", 0, func);
+  st_insert(func->attr.name, 0, func);
 }
 
 /* nullProc is a do-nothing procedure to 
@@ -188,7 +189,7 @@ static void insertNode( TreeNode * t)
     case ParamK:
       if (t->child[0]->attr.type == VOID)
         symbolError(t->child[0],"void type parameter is not allowed");
-      if (st_lookup(t->attr.name) == -1) {
+      if (!st_exist_top(t->attr.name)) {
         st_insert(t->attr.name,t->lineno,t);
         if (t->kind.param == NonArrParamK)
           t->type = Integer;
@@ -201,11 +202,36 @@ static void insertNode( TreeNode * t)
   }
 }
 
+/* Function isUnusedDecl tells whether the local
+ * declaration t (whose scope is on top) is never
+ * referenced
+ */
+int isUnusedDecl(TreeNode * t)
+{ char * name = (t->kind.decl == ArrVarK) ? t->attr.arr.name
+                                          : t->attr.name;
+  BucketList l = st_bucket(name);
+  return (l != NULL) && (l->treeNode == t) && (l->lines->next == NULL);
+}
+
+/* Procedure unusedWarning lists the local variables
+ * declared in compound statement t (whose scope is
+ * on top) that are never referenced
+ */
+static void unusedWarning(TreeNode * t)
+{ TreeNode * p;
+  for (p = t->child[0]; p != NULL; p = p->sibling)
+    if ((p->nodekind == DeclK) && isUnusedDecl(p))
+      fprintf(listing,"Symbol warning at line %d: %s is never used\n",
+              p->lineno,
+              (p->kind.decl == ArrVarK) ? p->attr.arr.name : p->attr.name);
+}
+
 static void afterInsertNode( TreeNode * t )
 { switch (t->nodekind)
   { case StmtK:
       switch (t->kind.stmt)
       { case CompK:
+          unusedWarning(t);
           scope_pop(t->lineno);
           break;    
           default:
@@ -388,6 +414,8 @@ static void checkNode(TreeNode * t)
             
             arg = t->child[0];
             param = funcDecl->child[1];
+            if ((param != NULL) && (param->nodekind != ParamK))
+              param = NULL; /* (void) parameter list */
 
             if (funcDecl->kind.decl != FuncK)
             { typeError(t,"expected function symbol");
@@ -410,7 +438,7 @@ static void checkNode(TreeNode * t)
             if (arg == NULL && param != NULL)
             /* the number of arguments does not match to
                that of parameters */
-              typeError(t->child[0],"the number of parameters is wrong");
+              typeError(t,"the number of parameters is wrong");
             
             t->type = funcDecl->type;
           }
@@ -18,4 +18,10 @@ void buildSymtab(TreeNode *);
  */
 void typeCheck(TreeNode *);
 
+/* Function isUnusedDecl tells whether the local
+ * declaration t (whose scope is on top) is never
+ * referenced
+ */
+int isUnusedDecl(TreeNode *);
+
 #endif
@@ -0,0 +1,93 @@
+/****************************************************/
+/* File: arena.c                                    */
+/* Arena allocation for the C-Minus compiler        */
+/****************************************************/
+
+#include "globals.h"
+#include "arena.h"
+
+/* a block starts with its link, padded so that the
+   memory after it is aligned for any type */
+typedef union
+   { long l;
+     double d;
+     void * p;
+   } Align;
+
+struct ArenaBlockRec
+   { ArenaBlock next;
+     Align pad;
+   };
+
+#define ALIGNED(n) (((n) + sizeof(Align) - 1) / sizeof(Align) * sizeof(Align))
+
+/* Function newBlock gets a block of size bytes and
+ * links it to a, after the newest block if behind
+ * is TRUE
+ */
+static ArenaBlock newBlock( Arena * a, int size, int behind )
+{ ArenaBlock b = (ArenaBlock) malloc(sizeof(struct ArenaBlockRec) + size);
+  if (b == NULL) return NULL;
+  if (behind && (a->blocks != NULL))
+  { b->next = a->blocks->next;
+    a->blocks->next = b;
+  }
+  else
+  { b->next = a->blocks;
+    a->blocks = b;
+  }
+  a->nblocks++;
+  a->reserved += size;
+  return b;
+}
+
+/* Function arenaAlloc returns size bytes from a,
+ * starting a new block when the newest one is full
+ */
+void * arenaAlloc( Arena * a, int size )
+{ ArenaBlock b;
+  void * p;
+  int n = ALIGNED(size > 0 ? size : 1);
+  if (n > ARENA_BLOCK / 4)
+  { /* a large request gets a block of its own, so
+       the room left in the newest block is kept */
+    b = newBlock(a,n,TRUE);
+    if (b == NULL) return NULL;
+    p = (void *) (b + 1);
+  }
+  else
+  { if (a->end - a->next < n)
+    { b = newBlock(a,ARENA_BLOCK,FALSE);
+      if (b == NULL) return NULL;
+      a->next = (char *) (b + 1);
+      a->end = a->next + ARENA_BLOCK;
+    }
+    p = (void *) a->next;
+    a->next += n;
+  }
+  a->allocs++;
+  a->used += n;
+  return p;
+}
+
+/* Procedure arenaFree releases the blocks of a */
+void arenaFree( Arena * a )
+{ ArenaBlock b, next;
+  for (b = a->blocks; b != NULL; b = next)
+  { next = b->next;
+    free(b);
+  }
+  a->blocks = NULL;
+  a->next = a->end = NULL;
+  a->allocs = a->used = a->reserved = 0;
+  a->nblocks = 0;
+}
+
+/* Procedure arenaStats prints the allocation counts
+ * of a to the listing file
+ */
+void arenaStats( Arena * a, char * name )
+{ fprintf(listing,"\n%s memory: %ld allocations, %ld bytes used"
+                  " in %d blocks of %ld bytes\n",
+          name,a->allocs,a->used,a->nblocks,a->reserved);
+}
@@ -0,0 +1,48 @@
+/****************************************************/
+/* File: arena.h                                    */
+/* Arena allocation for the C-Minus compiler        */
+/****************************************************/
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+/* An arena hands out memory from large blocks by
+ * moving a pointer, and releases all of it at once.
+ * The syntax tree nodes and the strings they hold
+ * are allocated from one, as they all live until
+ * the code has been generated.
+ */
+
+/* the size of the blocks the arena gets from malloc;
+   requests over a quarter of it get a block of their
+   own */
+#define ARENA_BLOCK 65536
+
+typedef struct ArenaBlockRec * ArenaBlock;
+
+typedef struct
+   { ArenaBlock blocks;  /* newest first */
+     char * next;        /* free space in the newest block */
+     char * end;
+     long allocs;        /* counts for the statistics */
+     long used;
+     long reserved;
+     int nblocks;
+   } Arena;
+
+/* Function arenaAlloc returns size bytes from a,
+ * aligned for any type, or NULL if out of memory
+ */
+void * arenaAlloc( Arena * a, int size );
+
+/* Procedure arenaFree releases all the memory of a,
+ * which can then be used again
+ */
+void arenaFree( Arena * a );
+
+/* Procedure arenaStats prints the allocation counts
+ * of a to the listing file
+ */
+void arenaStats( Arena * a, char * name );
+
+#endif
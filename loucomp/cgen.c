@@ -1,7 +1,7 @@
 /****************************************************/
 /* File: cgen.c                                     */
 /* The code generator implementation                */
-/* for the TINY compiler                            */
+/* for the C-Minus compiler                         */
 /* (generates code for the TM machine)              */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
@@ -10,32 +10,390 @@
 #include "globals.h"
 #include "symtab.h"
 #include "code.h"
+#include "ir.h"
 #include "cgen.h"
 
-/* tmpOffset is the memory offset for temps
-   It is decremented each time a temp is
-   stored, and incremeted when loaded again
+/* Activation record layout, as offsets from fp:
+ *
+ *    ofpFO      old frame pointer (caller's fp)
+ *    retFO      return address
+ *    initFO     first parameter, further parameters
+ *               and then the locals below it
+ *
+ * Frames are built from the top of memory downwards,
+ * while global variables are allocated upwards from
+ * location 0 (gp). A new frame starts at the first
+ * free location of the caller's frame.
+ */
+#define ofpFO 0
+#define retFO -1
+#define initFO -2
+
+/* tmpOffset is the fp-relative offset of the next
+   free location of the current frame. Locals are
+   allocated there on entry to a block, and temps
+   are pushed there while evaluating expressions:
+   it is decremented each time a temp is stored,
+   and incremented when loaded again
 */
 static int tmpOffset = 0;
 
-/* prototype for internal recursive code generator */
+/* globalOffset is the next free gp-relative
+   location for a global variable
+*/
+static int globalOffset = 0;
+
+/* curFunc is the function being generated, or
+   NULL at the global level
+*/
+static TreeNode * curFunc = NULL;
+
+/* prototypes for internal recursive code generator */
 static void cGen (TreeNode * tree);
+static void genExp (TreeNode * tree, int r);
+
+/* Function lookupDecl returns the declaration
+ * node a name refers to in the current scope
+ */
+TreeNode * lookupDecl( char * name )
+{ BucketList l = st_bucket(name);
+  return l == NULL ? NULL : l->treeNode;
+}
+
+/* Function isArrayDecl tells whether a declaration
+ * declares an array (a variable or a parameter)
+ */
+static int isArrayDecl( TreeNode * decl )
+{ if (decl->nodekind == DeclK) return decl->kind.decl == ArrVarK;
+  if (decl->nodekind == ParamK) return decl->kind.param == ArrParamK;
+  return FALSE;
+}
+
+/* Procedure genVarAddr generates code to load into
+ * register r the address of the variable (or the
+ * start of the array) declared by decl
+ */
+static void genVarAddr( int r, TreeNode * decl )
+{ if ((decl->nodekind == ParamK) && (decl->kind.param == ArrParamK))
+    /* array parameters hold the address of the array */
+    emitRM("LD",r,decl->memloc,fp,"load array param address");
+  else if (decl->memloc >= 0)
+    emitRM("LDA",r,decl->memloc,gp,"load global address");
+  else
+    emitRM("LDA",r,decl->memloc,fp,"load local address");
+}
+
+/* Registers ac (0) up to NO_TEMP_REGS-1 hold the
+ * temporaries of expression evaluation; the others
+ * are fp, gp, mp and pc
+ */
+#define NO_TEMP_REGS 4
+
+/* Expressions are evaluated with Sethi-Ullman
+ * register allocation: genExp(tree,r) leaves the
+ * value of tree in register r, using only the
+ * registers from r up, and evaluates the operand
+ * needing more registers first. Temps are spilled
+ * to the frame only when an expression needs more
+ * than NO_TEMP_REGS registers.
+ *
+ * A call clobbers every register, so it counts as
+ * needing all of them: it is then always evaluated
+ * while no other temporary is live in a register.
+ */
+
+/* Function regNeed returns the number of registers
+ * needed to evaluate tree (the element address of
+ * an ArrIdK tree if addr is TRUE) without spilling
+ */
+int regNeed( TreeNode * tree, int addr )
+{ int n1, n2;
+  switch (tree->kind.exp) {
+    case ArrIdK :
+      n1 = regNeed(tree->child[0],FALSE);
+      return n1 > 2 ? n1 : 2;
+    case CallK :
+      if (strcmp(tree->attr.name,"input") == 0) return 1;
+      if (strcmp(tree->attr.name,"output") == 0)
+        return regNeed(tree->child[0],FALSE);
+      return NO_TEMP_REGS;
+    case AssignK :
+      if (tree->child[0]->kind.exp != ArrIdK)
+        return regNeed(tree->child[1],FALSE);
+      n1 = regNeed(tree->child[1],FALSE);
+      n2 = regNeed(tree->child[0],TRUE);
+      break;
+    case OpK :
+      n1 = regNeed(tree->child[0],FALSE);
+      n2 = regNeed(tree->child[1],FALSE);
+      break;
+    default :
+      return 1;
+  }
+  if (n1 == n2) return n1 + 1;
+  return n1 > n2 ? n1 : n2;
+}
+
+/* Procedure genElemAddr generates code to load into
+ * register r the address of the array element tree
+ * refers to
+ */
+static void genElemAddr( TreeNode * tree, int r )
+{ TreeNode * decl = lookupDecl(tree->attr.name);
+  /* gen code for r = index */
+  genExp(tree->child[0],r);
+  genVarAddr(r+1,decl);
+  emitRO("ADD",r,r+1,r,"compute element address");
+}
+
+/* Procedure genPair generates code for two operands
+ * (element addresses if addr1/addr2 are TRUE) into
+ * registers r and r+1, evaluating the one needing
+ * more registers first, and returns in *r1 and *r2
+ * the registers holding the first and second operand
+ */
+static void genPair( TreeNode * t1, int addr1, TreeNode * t2, int addr2,
+                     int r, int * r1, int * r2 )
+{ int n1 = regNeed(t1,addr1), n2 = regNeed(t2,addr2);
+  int swap = n2 > n1;
+  TreeNode * first = swap ? t2 : t1, * second = swap ? t1 : t2;
+  int addrFirst = swap ? addr2 : addr1, addrSecond = swap ? addr1 : addr2;
+  int rFirst, rSecond;
+  if (addrFirst) genElemAddr(first,r); else genExp(first,r);
+  if (r + 1 + (swap ? n1 : n2) <= NO_TEMP_REGS)
+  { rFirst = r;
+    rSecond = r + 1;
+    if (addrSecond) genElemAddr(second,rSecond);
+    else genExp(second,rSecond);
+  }
+  else
+  { /* not enough registers: spill the first operand */
+    emitRM("ST",r,tmpOffset--,fp,"spill temp");
+    if (addrSecond) genElemAddr(second,r); else genExp(second,r);
+    rFirst = r + 1;
+    rSecond = r;
+    emitRM("LD",rFirst,++tmpOffset,fp,"reload temp");
+  }
+  *r1 = swap ? rSecond : rFirst;
+  *r2 = swap ? rFirst : rSecond;
+}
+
+/* Procedure genCall generates code at a call node
+ * leaving its value in register r: the arguments
+ * are stored in the new frame, which starts at
+ * tmpOffset, and the called function returns its
+ * value in ac
+ */
+static void genCall( TreeNode * tree, int r )
+{ TreeNode * func = lookupDecl(tree->attr.name);
+  TreeNode * arg;
+  int frameBase = tmpOffset;
+  int nargs = 0;
+  if (strcmp(tree->attr.name,"input") == 0)
+  { emitRO("IN",r,0,0,"input integer value");
+    return;
+  }
+  if (strcmp(tree->attr.name,"output") == 0)
+  { genExp(tree->child[0],r);
+    emitRO("OUT",r,0,0,"output value");
+    return;
+  }
+  if (TraceCode) emitComment("-> call") ;
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+    nargs++;
+  /* temps used by the arguments go below the new frame */
+  tmpOffset = frameBase + initFO - nargs;
+  nargs = 0;
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+  { emitSourceLine(arg->lineno);
+    genExp(arg,ac);
+    emitRM("ST",ac,frameBase+initFO-nargs,fp,"call: store argument");
+    nargs++;
+  }
+  emitRM("ST",fp,frameBase+ofpFO,fp,"call: store old fp");
+  emitRM("LDA",fp,frameBase,fp,"call: push frame");
+  emitRM("LDA",ac,1,pc,"call: return address");
+  emitRM_Abs("LDA",pc,func->memloc,"call: jump to function");
+  emitRM("LD",fp,ofpFO,fp,"call: pop frame");
+  if (r != ac) emitRM("LDA",r,0,ac,"call: move result");
+  tmpOffset = frameBase;
+  if (TraceCode) emitComment("<- call") ;
+}
+
+/* Function passesLocalArray tells whether a call
+ * passes the address of an array in the current
+ * frame, which a tail call would reuse
+ */
+int passesLocalArray( TreeNode * tree )
+{ TreeNode * arg, * decl;
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+    if ((arg->nodekind == ExpK) && (arg->kind.exp == IdK))
+    { decl = lookupDecl(arg->attr.name);
+      if ((decl != NULL) && (decl->nodekind == DeclK)
+          && (decl->kind.decl == ArrVarK) && (decl->memloc < 0))
+        return TRUE;
+    }
+  return FALSE;
+}
+
+/* Function isTailCall tells whether expression
+ * tree, returned by curFunc, is a call of curFunc
+ * itself that can be replaced by a jump
+ */
+static int isTailCall( TreeNode * tree )
+{ return (IrOpt & OPT_TAIL) && (tree != NULL)
+         && (tree->nodekind == ExpK) && (tree->kind.exp == CallK)
+         && (lookupDecl(tree->attr.name) == curFunc)
+         && !passesLocalArray(tree);
+}
+
+/* Procedure genTailCall generates code for a call
+ * of curFunc to itself in a return: the arguments
+ * are evaluated into the temps, copied over the
+ * parameters, and the body is entered again past
+ * the store of the return address, reusing the
+ * frame of the current call
+ */
+static void genTailCall( TreeNode * tree )
+{ TreeNode * arg;
+  int frameBase = tmpOffset;
+  int nargs = 0, i;
+  if (TraceCode) emitComment("-> tail call") ;
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+    nargs++;
+  tmpOffset = frameBase - nargs;
+  nargs = 0;
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+  { emitSourceLine(arg->lineno);
+    genExp(arg,ac);
+    emitRM("ST",ac,frameBase-nargs,fp,"tail call: save argument");
+    nargs++;
+  }
+  for (i = 0; i < nargs; i++)
+  { emitRM("LD",ac,frameBase-i,fp,"tail call: load argument");
+    emitRM("ST",ac,initFO-i,fp,"tail call: store parameter");
+  }
+  tmpOffset = frameBase;
+  emitRM_Abs("LDA",pc,curFunc->memloc+1,"tail call: jump to body");
+  if (TraceCode) emitComment("<- tail call") ;
+}
+
+/* Procedure genDecl generates code at a declaration
+ * node, allocating storage for variables
+ */
+static void genDecl( TreeNode * tree)
+{ TreeNode * p;
+  int size;
+  switch (tree->kind.decl) {
+
+      case FuncK :
+         if (TraceCode) emitComment("-> function") ;
+         curFunc = tree;
+         emitFunction(tree->attr.name);
+         tree->memloc = emitSkip(0);
+         emitRM("ST",ac,retFO,fp,"function: store return address");
+         /* parameters were stored by the caller */
+         tmpOffset = initFO;
+         for (p = tree->child[1]; p != NULL; p = p->sibling)
+           if (p->nodekind == ParamK)
+             p->memloc = tmpOffset--;
+         cGen(tree->child[2]);
+         emitRM("LD",pc,retFO,fp,"function: return to caller");
+         emitFunction(NULL);
+         curFunc = NULL;
+         if (TraceCode) emitComment("<- function") ;
+         break; /* FuncK */
+
+      case VarK :
+      case ArrVarK :
+         size = (tree->kind.decl == ArrVarK) ? tree->attr.arr.size : 1;
+         if (curFunc == NULL)
+         { /* global variable */
+           tree->memloc = globalOffset;
+           globalOffset += size;
+         }
+         else
+         { tmpOffset -= size;
+           tree->memloc = tmpOffset + 1;
+         }
+         break; /* VarK, ArrVarK */
+
+      default:
+         break;
+    }
+} /* genDecl */
+
+/* Function genTest generates code for the test of
+ * an if or while statement and leaves room for the
+ * jump taken when the test is false; it returns the
+ * location of that jump and in *jmp the conditional
+ * jump to backpatch there, which tests ac. A
+ * comparison is compiled to a SUB followed by that
+ * jump on the inverted condition, instead of first
+ * computing its 0/1 value and testing it again.
+ */
+static int genTest( TreeNode * tree, char ** jmp )
+{ TreeNode * p1, * p2;
+  int r1, r2;
+  emitSourceLine(tree->lineno);
+  if ((tree->nodekind != ExpK) || (tree->kind.exp != OpK))
+  { cGen(tree);
+    *jmp = "JEQ";
+    return emitSkip(1);
+  }
+  switch (tree->attr.op) {
+    case LT : *jmp = "JGE"; break;
+    case LE : *jmp = "JGT"; break;
+    case GT : *jmp = "JLE"; break;
+    case GE : *jmp = "JLT"; break;
+    case EQ : *jmp = "JNE"; break;
+    case NE : *jmp = "JEQ"; break;
+    default :
+      cGen(tree);
+      *jmp = "JEQ";
+      return emitSkip(1);
+  }
+  if (TraceCode) emitComment("-> test") ;
+  p1 = tree->child[0];
+  p2 = tree->child[1];
+  if ((p2->kind.exp == ConstK) && (p2->attr.val == 0))
+    /* comparison with 0: test the operand itself */
+    genExp(p1,ac);
+  else
+  { genPair(p1,FALSE,p2,FALSE,ac,&r1,&r2);
+    emitRO("SUB",ac,r1,r2,"test: compare");
+  }
+  if (TraceCode) emitComment("<- test") ;
+  return emitSkip(1);
+}
 
 /* Procedure genStmt generates code at a statement node */
 static void genStmt( TreeNode * tree)
 { TreeNode * p1, * p2, * p3;
   int savedLoc1,savedLoc2,currentLoc;
-  int loc;
+  int savedOffset;
+  char * jmp;
   switch (tree->kind.stmt) {
 
+      case CompK :
+         if (TraceCode) emitComment("-> compound") ;
+         scope_push(tree->attr.scope);
+         savedOffset = tmpOffset;
+         /* allocate the locals, then the statements */
+         cGen(tree->child[0]);
+         cGen(tree->child[1]);
+         tmpOffset = savedOffset;
+         scope_pop(-1);
+         if (TraceCode) emitComment("<- compound") ;
+         break; /* CompK */
+
       case IfK :
          if (TraceCode) emitComment("-> if") ;
          p1 = tree->child[0] ;
          p2 = tree->child[1] ;
          p3 = tree->child[2] ;
          /* generate code for test expression */
-         cGen(p1);
-         savedLoc1 = emitSkip(1) ;
+         savedLoc1 = genTest(p1,&jmp) ;
          emitComment("if: jump to else belongs here");
          /* recurse on then part */
          cGen(p2);
@@ -43,7 +401,7 @@ static void genStmt( TreeNode * tree)
          emitComment("if: jump to end belongs here");
          currentLoc = emitSkip(0) ;
          emitBackup(savedLoc1) ;
-         emitRM_Abs("JEQ",ac,currentLoc,"if: jmp to else");
+         emitRM_Abs(jmp,ac,currentLoc,"if: jmp to else");
          emitRestore() ;
          /* recurse on else part */
          cGen(p3);
@@ -54,104 +412,149 @@ static void genStmt( TreeNode * tree)
          if (TraceCode)  emitComment("<- if") ;
          break; /* if_k */
 
-      case RepeatK:
-         if (TraceCode) emitComment("-> repeat") ;
+      case IterK:
+         if (TraceCode) emitComment("-> while") ;
          p1 = tree->child[0] ;
          p2 = tree->child[1] ;
          savedLoc1 = emitSkip(0);
-         emitComment("repeat: jump after body comes back here");
-         /* generate code for body */
-         cGen(p1);
+         emitComment("while: jump after body comes back here");
          /* generate code for test */
+         savedLoc2 = genTest(p1,&jmp) ;
+         emitComment("while: jump to end belongs here");
+         /* generate code for body */
          cGen(p2);
-         emitRM_Abs("JEQ",ac,savedLoc1,"repeat: jmp back to body");
-         if (TraceCode)  emitComment("<- repeat") ;
-         break; /* repeat */
+         emitRM_Abs("LDA",pc,savedLoc1,"while: jmp back to test");
+         currentLoc = emitSkip(0) ;
+         emitBackup(savedLoc2) ;
+         emitRM_Abs(jmp,ac,currentLoc,"while: jmp to end");
+         emitRestore() ;
+         if (TraceCode)  emitComment("<- while") ;
+         break; /* while */
 
-      case AssignK:
-         if (TraceCode) emitComment("-> assign") ;
-         /* generate code for rhs */
-         cGen(tree->child[0]);
-         /* now store value */
-         loc = st_lookup(tree->attr.name);
-         emitRM("ST",ac,loc,gp,"assign: store value");
-         if (TraceCode)  emitComment("<- assign") ;
-         break; /* assign_k */
-
-      case ReadK:
-         emitRO("IN",ac,0,0,"read integer value");
-         loc = st_lookup(tree->attr.name);
-         emitRM("ST",ac,loc,gp,"read: store value");
-         break;
-      case WriteK:
-         /* generate code for expression to write */
+      case RetK:
+         if (isTailCall(tree->child[0]))
+         { genTailCall(tree->child[0]);
+           break;
+         }
+         if (TraceCode) emitComment("-> return") ;
+         /* generate code for the return value */
          cGen(tree->child[0]);
-         /* now output it */
-         emitRO("OUT",ac,0,0,"write ac");
-         break;
+         emitRM("LD",pc,retFO,fp,"return: to caller");
+         if (TraceCode)  emitComment("<- return") ;
+         break; /* return */
+
       default:
          break;
     }
 } /* genStmt */
 
-/* Procedure genExp generates code at an expression node */
-static void genExp( TreeNode * tree)
-{ int loc;
-  TreeNode * p1, * p2;
+/* Procedure genCompare generates code setting
+ * register r to 1 if conditional jump jmp branches
+ * on the difference of registers l and r2, else 0
+ */
+static void genCompare( char * jmp, int r, int l, int r2, char * c )
+{ emitRO("SUB",r,l,r2,c) ;
+  emitRM(jmp,r,2,pc,"br if true") ;
+  emitRM("LDC",r,0,r,"false case") ;
+  emitRM("LDA",pc,1,pc,"unconditional jmp") ;
+  emitRM("LDC",r,1,r,"true case") ;
+}
+
+/* Procedure genExp generates code at an expression
+ * node, leaving its value in register r
+ */
+static void genExp( TreeNode * tree, int r )
+{ TreeNode * p1, * p2;
+  TreeNode * decl;
+  int r1, r2;
   switch (tree->kind.exp) {
 
     case ConstK :
       if (TraceCode) emitComment("-> Const") ;
       /* gen code to load integer constant using LDC */
-      emitRM("LDC",ac,tree->attr.val,0,"load const");
+      emitRM("LDC",r,tree->attr.val,0,"load const");
       if (TraceCode)  emitComment("<- Const") ;
       break; /* ConstK */
-    
+
     case IdK :
       if (TraceCode) emitComment("-> Id") ;
-      loc = st_lookup(tree->attr.name);
-      emitRM("LD",ac,loc,gp,"load id value");
+      decl = lookupDecl(tree->attr.name);
+      if (isArrayDecl(decl))
+        /* the value of an array name is its address */
+        genVarAddr(r,decl);
+      else
+        emitRM("LD",r,decl->memloc,decl->memloc >= 0 ? gp : fp,
+               "load id value");
       if (TraceCode)  emitComment("<- Id") ;
       break; /* IdK */
 
+    case ArrIdK :
+      if (TraceCode) emitComment("-> ArrId") ;
+      genElemAddr(tree,r);
+      emitRM("LD",r,0,r,"load element value");
+      if (TraceCode)  emitComment("<- ArrId") ;
+      break; /* ArrIdK */
+
+    case CallK :
+      genCall(tree,r);
+      break; /* CallK */
+
+    case AssignK :
+      if (TraceCode) emitComment("-> assign") ;
+      p1 = tree->child[0];
+      p2 = tree->child[1];
+      if (p1->kind.exp == ArrIdK)
+      { /* gen code for rhs and element address */
+        genPair(p2,FALSE,p1,TRUE,r,&r1,&r2);
+        emitRM("ST",r1,0,r2,"assign: store value");
+        if (r1 != r) emitRM("LDA",r,0,r1,"assign: move value");
+      }
+      else
+      { /* gen code for rhs */
+        genExp(p2,r);
+        decl = lookupDecl(p1->attr.name);
+        emitRM("ST",r,decl->memloc,decl->memloc >= 0 ? gp : fp,
+               "assign: store value");
+      }
+      if (TraceCode)  emitComment("<- assign") ;
+      break; /* AssignK */
+
     case OpK :
          if (TraceCode) emitComment("-> Op") ;
          p1 = tree->child[0];
          p2 = tree->child[1];
-         /* gen code for ac = left arg */
-         cGen(p1);
-         /* gen code to push left operand */
-         emitRM("ST",ac,tmpOffset--,mp,"op: push left");
-         /* gen code for ac = right operand */
-         cGen(p2);
-         /* now load left operand */
-         emitRM("LD",ac1,++tmpOffset,mp,"op: load left");
+         /* gen code for the operands into r1 and r2 */
+         genPair(p1,FALSE,p2,FALSE,r,&r1,&r2);
          switch (tree->attr.op) {
             case PLUS :
-               emitRO("ADD",ac,ac1,ac,"op +");
+               emitRO("ADD",r,r1,r2,"op +");
                break;
             case MINUS :
-               emitRO("SUB",ac,ac1,ac,"op -");
+               emitRO("SUB",r,r1,r2,"op -");
                break;
             case TIMES :
-               emitRO("MUL",ac,ac1,ac,"op *");
+               emitRO("MUL",r,r1,r2,"op *");
                break;
             case OVER :
-               emitRO("DIV",ac,ac1,ac,"op /");
+               emitRO("DIV",r,r1,r2,"op /");
                break;
             case LT :
-               emitRO("SUB",ac,ac1,ac,"op <") ;
-               emitRM("JLT",ac,2,pc,"br if true") ;
-               emitRM("LDC",ac,0,ac,"false case") ;
-               emitRM("LDA",pc,1,pc,"unconditional jmp") ;
-               emitRM("LDC",ac,1,ac,"true case") ;
+               genCompare("JLT",r,r1,r2,"op <");
+               break;
+            case LE :
+               genCompare("JLE",r,r1,r2,"op <=");
+               break;
+            case GT :
+               genCompare("JGT",r,r1,r2,"op >");
+               break;
+            case GE :
+               genCompare("JGE",r,r1,r2,"op >=");
                break;
             case EQ :
-               emitRO("SUB",ac,ac1,ac,"op ==") ;
-               emitRM("JEQ",ac,2,pc,"br if true");
-               emitRM("LDC",ac,0,ac,"false case") ;
-               emitRM("LDA",pc,1,pc,"unconditional jmp") ;
-               emitRM("LDC",ac,1,ac,"true case") ;
+               genCompare("JEQ",r,r1,r2,"op ==");
+               break;
+            case NE :
+               genCompare("JNE",r,r1,r2,"op !=");
                break;
             default:
                emitComment("BUG: Unknown operator");
@@ -170,12 +573,16 @@ static void genExp( TreeNode * tree)
  */
 static void cGen( TreeNode * tree)
 { if (tree != NULL)
-  { switch (tree->nodekind) {
+  { emitSourceLine(tree->lineno);
+    switch (tree->nodekind) {
       case StmtK:
         genStmt(tree);
         break;
       case ExpK:
-        genExp(tree);
+        genExp(tree,ac);
+        break;
+      case DeclK:
+        genDecl(tree);
         break;
       default:
         break;
@@ -195,18 +602,37 @@ static void cGen( TreeNode * tree)
  */
 void codeGen(TreeNode * syntaxTree, char * codefile)
 {  char * s = malloc(strlen(codefile)+7);
+   TreeNode * t, * mainFunc = NULL;
+   int savedLoc;
    strcpy(s,"File: ");
    strcat(s,codefile);
-   emitComment("TINY Compilation to TM Code");
+   emitComment("C-Minus Compilation to TM Code");
    emitComment(s);
    /* generate standard prelude */
    emitComment("Standard prelude:");
    emitRM("LD",mp,0,ac,"load maxaddress from location 0");
    emitRM("ST",ac,0,ac,"clear location 0");
-   emitComment("End of standard prelude.");
-   /* generate code for TINY program */
-   cGen(syntaxTree);
-   /* finish */
+   emitRM("LDA",fp,0,mp,"first frame at top of memory");
+   emitRM("ST",fp,ofpFO,fp,"call main: store old fp");
+   emitRM("LDA",ac,1,pc,"call main: return address");
+   savedLoc = emitSkip(1);
+   emitComment("call main: jump to main belongs here");
    emitComment("End of execution.");
    emitRO("HALT",0,0,0,"");
+   emitComment("End of standard prelude.");
+   /* generate code for C-Minus program */
+   cGen(syntaxTree);
+   /* main is the last declaration */
+   for (t = syntaxTree; t != NULL; t = t->sibling)
+     if ((t->nodekind == DeclK) && (t->kind.decl == FuncK)
+         && (strcmp(t->attr.name,"main") == 0))
+       mainFunc = t;
+   emitBackup(savedLoc);
+   if (mainFunc != NULL)
+     emitRM_Abs("LDA",pc,mainFunc->memloc,"call main: jump to main");
+   else
+   { fprintf(listing,"Code generation error: no main function\n");
+     emitRO("HALT",0,0,0,"no main function");
+   }
+   emitRestore();
 }
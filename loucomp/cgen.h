@@ -16,4 +16,26 @@
  */
 void codeGen(TreeNode * syntaxTree, char * codefile);
 
+/* Function lookupDecl returns the declaration
+ * node a name refers to in the current scope
+ */
+TreeNode * lookupDecl(char * name);
+
+/* Function regNeed returns the number of registers
+ * needed to evaluate expression tree (the element
+ * address of an ArrIdK tree if addr is TRUE); the
+ * IR generator (ir.c) evaluates operands in the
+ * order it gives, the one needing more registers
+ * first, so side effects happen in the same order
+ * in both back ends
+ */
+int regNeed(TreeNode * tree, int addr);
+
+/* Function passesLocalArray tells whether call tree
+ * passes the address of an array in the current
+ * frame; neither back end turns such a self call
+ * into a jump, which would reuse the frame
+ */
+int passesLocalArray(TreeNode * tree);
+
 #endif
@@ -47,12 +47,12 @@ decl        : var_decl  { $$ = $1; }
             | fun_decl  { $$ = $1; }
             ;
 saveName    : ID
-                 { savedName = copyString(tokenString);
+                 { savedName = tokenName;
                    savedLineNo = lineno;
                  }
             ;
 saveNumber  : NUM
-                 { savedNumber = atoi(tokenString);
+                 { savedNumber = tokenValue;
                    savedLineNo = lineno;
                  }
             ;
@@ -221,8 +221,8 @@ simple_exp  : add_exp rel_op add_exp
             ;
 rel_op  : LE { $$ = LE; }
         | LT { $$ = LT; }
-        | GT { $$ = GE; }
-        | GE { $$ = GT; }
+        | GT { $$ = GT; }
+        | GE { $$ = GE; }
         | EQ { $$ = EQ; }
         | NE { $$ = NE; }
         ;
@@ -263,7 +263,7 @@ factor      : LPAREN exp RPAREN { $$ = $2; }
             | call { $$ = $1; }
             | NUM
                  { $$ = newExpNode(ConstK);
-                   $$->attr.val = atoi(tokenString);
+                   $$->attr.val = tokenValue;
                    $$->type = Integer;
                  }
             ;
@@ -296,7 +296,7 @@ arg_list    : arg_list COMMA exp
 int yyerror(char * message)
 { fprintf(listing,"Syntax error at line %d: %s\n",lineno,message);
   fprintf(listing,"Current token: ");
-  printToken(yychar,tokenString);
+  printToken(yychar,tokenText);
   Error = TRUE;
   return 0;
 }
@@ -7,7 +7,10 @@
 /****************************************************/
 
 #include "globals.h"
+#include "util.h"
 #include "code.h"
+#include "tmobj.h"
+#include "peep.h"
 
 /* TM location number for current instruction emission */
 static int emitLoc = 0 ;
@@ -17,11 +20,113 @@ static int emitLoc = 0 ;
    emitBackup, and emitRestore */
 static int highEmitLoc = 0;
 
+/* TM mnemonics, indexed by OPCODE */
+static char * opCodeTab[]
+        = {"HALT","IN","OUT","ADD","SUB","MUL","DIV","????",
+           "LD","ST","????",
+           "LDA","LDC","JLT","JLE","JGT","JGE","JEQ","JNE"
+          };
+
+/* the emitted code is also kept in memory, one
+   entry per location, for the binary image;
+   lineBuf holds the source line of each location
+   and funcBuf the name table offset of the
+   enclosing function (-1 for none) */
+static INSTRUCTION * codeBuf = NULL;
+static int * lineBuf = NULL;
+static int * funcBuf = NULL;
+static int codeBufSize = 0;
+
+/* with TraceCode, textBuf holds the comment of each
+   location, and comments the comment lines, each
+   printed before the instruction at its loc */
+static char ** textBuf = NULL;
+
+typedef struct {
+      int loc ;
+      int seq ;  /* order of emission */
+      char * text ;
+   } COMMENT;
+
+static COMMENT * comments = NULL;
+static int commentCount = 0;
+static int commentSize = 0;
+
+/* source line and function of the code being emitted */
+static int emitLineNo = 0;
+static int emitFuncName = -1;
+
+/* function names, each ended by '\0' */
+static char * nameBuf = NULL;
+static int nameBufSize = 0;
+
+/* Procedure reserve makes room in the code
+ * buffer for location loc, recording the current
+ * source line for a location not emitted before
+ */
+static void reserve( int loc )
+{ if (loc >= codeBufSize)
+  { int n = codeBufSize == 0 ? 256 : codeBufSize;
+    while (n <= loc) n *= 2;
+    codeBuf = (INSTRUCTION *) realloc(codeBuf, n * sizeof(INSTRUCTION));
+    lineBuf = (int *) realloc(lineBuf, n * sizeof(int));
+    funcBuf = (int *) realloc(funcBuf, n * sizeof(int));
+    textBuf = (char **) realloc(textBuf, n * sizeof(char *));
+    if ((codeBuf == NULL) || (lineBuf == NULL) || (funcBuf == NULL)
+        || (textBuf == NULL))
+    { fprintf(listing,"Out of memory error in code emitter\n");
+      exit(1);
+    }
+    memset(codeBuf + codeBufSize, 0,
+           (n - codeBufSize) * sizeof(INSTRUCTION));
+    memset(lineBuf + codeBufSize, 0, (n - codeBufSize) * sizeof(int));
+    memset(textBuf + codeBufSize, 0, (n - codeBufSize) * sizeof(char *));
+    codeBufSize = n;
+  }
+  if (loc >= highEmitLoc)
+  { lineBuf[loc] = emitLineNo;
+    funcBuf[loc] = emitFuncName;
+  }
+} /* reserve */
+
+/* Procedure record stores the instruction being
+ * emitted at emitLoc, with comment c, in the code
+ * buffer
+ */
+static void record( char * op, int a1, int a2, int a3, char * c)
+{ int i;
+  for (i = 0; i < opRALim; i++)
+    if (strcmp(op,opCodeTab[i]) == 0) break;
+  if (i == opRALim)
+  { emitComment("BUG: unknown opcode");
+    i = opHALT;
+  }
+  reserve(emitLoc);
+  codeBuf[emitLoc].iop = i;
+  codeBuf[emitLoc].iarg1 = a1;
+  codeBuf[emitLoc].iarg2 = a2;
+  codeBuf[emitLoc].iarg3 = a3;
+  if (TraceCode) textBuf[emitLoc] = copyString(c);
+} /* record */
+
 /* Procedure emitComment prints a comment line 
  * with comment c in the code file
  */
 void emitComment( char * c )
-{ if (TraceCode) fprintf(code,"* %s\n",c);}
+{ if (! TraceCode) return;
+  if (commentCount == commentSize)
+  { commentSize = commentSize == 0 ? 256 : 2 * commentSize;
+    comments = (COMMENT *) realloc(comments, commentSize * sizeof(COMMENT));
+    if (comments == NULL)
+    { fprintf(listing,"Out of memory error in code emitter\n");
+      exit(1);
+    }
+  }
+  comments[commentCount].loc = emitLoc;
+  comments[commentCount].seq = commentCount;
+  comments[commentCount].text = copyString(c);
+  commentCount++;
+}
 
 /* Procedure emitRO emits a register-only
  * TM instruction
@@ -32,9 +137,8 @@ void emitComment( char * c )
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRO( char *op, int r, int s, int t, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d,%d ",emitLoc++,op,r,s,t);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
+{ record(op,r,s,t,c);
+  emitLoc++ ;
   if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
 } /* emitRO */
 
@@ -47,9 +151,8 @@ void emitRO( char *op, int r, int s, int t, char *c)
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRM( char * op, int r, int d, int s, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",emitLoc++,op,r,d,s);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
+{ record(op,r,d,s,c);
+  emitLoc++ ;
   if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
 } /* emitRM */
 
@@ -59,6 +162,9 @@ void emitRM( char * op, int r, int d, int s, char *c)
  */
 int emitSkip( int howMany)
 {  int i = emitLoc;
+   int loc;
+   for (loc = emitLoc; loc < emitLoc + howMany; loc++)
+     reserve(loc);
    emitLoc += howMany ;
    if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
    return i;
@@ -88,10 +194,170 @@ void emitRestore(void)
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRM_Abs( char *op, int r, int a, char * c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",
-               emitLoc,op,r,a-(emitLoc+1),pc);
+{ record(op,r,a-(emitLoc+1),pc,c);
   ++emitLoc ;
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
   if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
 } /* emitRM_Abs */
+
+/* Function cmpComment orders comments by location
+ * and then by order of emission
+ */
+static int cmpComment( const void * a, const void * b )
+{ const COMMENT * x = (const COMMENT *) a, * y = (const COMMENT *) b;
+  if (x->loc != y->loc) return x->loc - y->loc;
+  return x->seq - y->seq;
+}
+
+/* Procedure emitFlush runs the peephole optimizer
+ * over the buffered code and writes it to the code
+ * file in location order
+ */
+void emitFlush(void)
+{ int * newLoc;
+  char * entry;
+  int loc, k, n = highEmitLoc;
+  newLoc = (int *) malloc((n + 1) * sizeof(int));
+  entry = (char *) calloc(n + 1, 1);
+  if ((newLoc == NULL) || (entry == NULL))
+  { fprintf(listing,"Out of memory error in code emitter\n");
+    exit(1);
+  }
+  /* location 0 and the function entry points are
+     entered without a jump in the code */
+  for (loc = 0; loc < n; loc++)
+    entry[loc] = (loc == 0) || ((funcBuf[loc] >= 0)
+                                && (funcBuf[loc] != funcBuf[loc-1]));
+  if (Peephole)
+  { n = peephole(codeBuf, highEmitLoc, entry, newLoc);
+    for (loc = 0; loc < highEmitLoc; loc++)
+      if (newLoc[loc] != newLoc[loc+1])
+      { lineBuf[newLoc[loc]] = lineBuf[loc];
+        funcBuf[newLoc[loc]] = funcBuf[loc];
+        textBuf[newLoc[loc]] = textBuf[loc];
+      }
+    for (k = 0; k < commentCount; k++)
+      comments[k].loc = newLoc[comments[k].loc];
+    emitLoc = highEmitLoc = n;
+  }
+  if (commentCount > 0)
+    qsort(comments,commentCount,sizeof(COMMENT),cmpComment);
+  k = 0;
+  for (loc = 0; loc <= n; loc++)
+  { while ((k < commentCount) && (comments[k].loc == loc))
+      fprintf(code,"* %s\n",comments[k++].text);
+    if (loc == n) break;
+    fprintf(code,"%3d:  %5s  %d,",loc,opCodeTab[codeBuf[loc].iop],
+            codeBuf[loc].iarg1);
+    if (codeBuf[loc].iop < opRRLim)
+      fprintf(code,"%d,%d ",codeBuf[loc].iarg2,codeBuf[loc].iarg3);
+    else
+      fprintf(code,"%d(%d) ",codeBuf[loc].iarg2,codeBuf[loc].iarg3);
+    if (TraceCode && (textBuf[loc] != NULL))
+      fprintf(code,"\t%s",textBuf[loc]);
+    fprintf(code,"\n");
+  }
+  free(newLoc);
+  free(entry);
+} /* emitFlush */
+
+/* Procedure emitSourceLine sets the source line
+ * recorded for the instructions emitted next
+ */
+void emitSourceLine( int lineno )
+{ emitLineNo = lineno; }
+
+/* Procedure emitFunction sets the function
+ * recorded for the instructions emitted next;
+ * name is NULL outside any function
+ */
+void emitFunction( char * name )
+{ int n = 0;
+  if (name == NULL)
+  { emitFuncName = -1;
+    return;
+  }
+  while ((n < nameBufSize) && (strcmp(nameBuf + n, name) != 0))
+    n += strlen(nameBuf + n) + 1;
+  if (n == nameBufSize)
+  { nameBuf = (char *) realloc(nameBuf, nameBufSize + strlen(name) + 1);
+    if (nameBuf == NULL)
+    { fprintf(listing,"Out of memory error in code emitter\n");
+      exit(1);
+    }
+    strcpy(nameBuf + n, name);
+    nameBufSize += strlen(name) + 1;
+  }
+  emitFuncName = n;
+} /* emitFunction */
+
+/* Function lineTableSize returns the number of
+ * line table entries for the code emitted so far,
+ * or 0 if no source lines were recorded
+ */
+static int lineTableSize(void)
+{ int loc, lines = 0;
+  for (loc = 0; loc < highEmitLoc; loc++)
+    if ((lineBuf[loc] != 0) || (funcBuf[loc] != -1)) lines = 1;
+  if (lines)
+  { lines = 0;
+    for (loc = 0; loc < highEmitLoc; loc++)
+      if ((loc == 0) || (lineBuf[loc] != lineBuf[loc-1])
+          || (funcBuf[loc] != funcBuf[loc-1]))
+        lines++;
+  }
+  return lines;
+} /* lineTableSize */
+
+/* Procedure emitLineTable writes the line table
+ * to the code file as "*@ loc line name" comment
+ * lines, one for each run of locations with the
+ * same source line and function
+ */
+void emitLineTable(void)
+{ int loc;
+  if (lineTableSize() == 0) return;
+  for (loc = 0; loc < highEmitLoc; loc++)
+    if ((loc == 0) || (lineBuf[loc] != lineBuf[loc-1])
+        || (funcBuf[loc] != funcBuf[loc-1]))
+    { fprintf(code,"*@ %d %d",loc,lineBuf[loc]);
+      if (funcBuf[loc] >= 0) fprintf(code," %s",nameBuf + funcBuf[loc]);
+      fprintf(code,"\n");
+    }
+} /* emitLineTable */
+
+/* Procedure emitObject writes the code emitted so
+ * far to obj as a binary TM image (see tmobj.h),
+ * with a line table if source lines were recorded
+ */
+void emitObject( FILE * obj )
+{ TMOBJHEADER h;
+  TMOBJLINE e;
+  int loc, lines = lineTableSize();
+  long pos;
+  h.magic = TMOBJ_MAGIC;
+  h.version = TMOBJ_VERSION;
+  h.imemSize = 0;
+  h.dmemSize = 0;
+  h.lineOffset = sizeof(h);
+  h.lineCount = lines;
+  h.nameOffset = h.lineOffset + lines * sizeof(TMOBJLINE);
+  h.nameSize = lines > 0 ? nameBufSize : 0;
+  h.codeOffset = (h.nameOffset + h.nameSize + TMOBJ_ALIGN - 1)
+                 / TMOBJ_ALIGN * TMOBJ_ALIGN;
+  h.codeCount = highEmitLoc;
+  fwrite(&h,sizeof(h),1,obj);
+  for (loc = 0; (lines > 0) && (loc < highEmitLoc); loc++)
+    if ((loc == 0) || (lineBuf[loc] != lineBuf[loc-1])
+        || (funcBuf[loc] != funcBuf[loc-1]))
+    { e.loc = loc;
+      e.line = lineBuf[loc];
+      e.name = funcBuf[loc];
+      fwrite(&e,sizeof(e),1,obj);
+    }
+  if (h.nameSize > 0)
+    fwrite(nameBuf,1,h.nameSize,obj);
+  for (pos = h.nameOffset + h.nameSize; pos < h.codeOffset; pos++)
+    fputc(0,obj);
+  if (highEmitLoc > 0)
+    fwrite(codeBuf,sizeof(INSTRUCTION),highEmitLoc,obj);
+} /* emitObject */
@@ -17,6 +17,11 @@
  */
 #define  mp 6
 
+/* fp = "frame pointer" points to the
+ * activation record of the current function
+ */
+#define fp 4
+
 /* gp = "global pointer" points
  * to bottom of memory for (global)
  * variable storage
@@ -83,4 +88,32 @@ void emitRestore(void);
  */
 void emitRM_Abs( char *op, int r, int a, char * c);
 
+/* Procedure emitFlush runs the peephole optimizer
+ * over the buffered code (if Peephole is set) and
+ * writes the code to the code file
+ */
+void emitFlush( void );
+
+/* Procedure emitSourceLine sets the source line
+ * recorded for the instructions emitted next
+ */
+void emitSourceLine( int lineno );
+
+/* Procedure emitFunction sets the function
+ * recorded for the instructions emitted next;
+ * name is NULL outside any function
+ */
+void emitFunction( char * name );
+
+/* Procedure emitLineTable writes the table of
+ * source lines and functions to the code file
+ * as "*@ loc line name" comment lines
+ */
+void emitLineTable( void );
+
+/* Procedure emitObject writes the code emitted so
+ * far to obj as a binary TM image (see tmobj.h)
+ */
+void emitObject( FILE * obj );
+
 #endif
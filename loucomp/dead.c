@@ -0,0 +1,89 @@
+/****************************************************/
+/* File: dead.c                                     */
+/* Dead code elimination on the syntax tree         */
+/* for the C-Minus compiler                         */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "analyze.h"
+#include "dead.h"
+
+/* counts for the TraceOpt report */
+static int statements;
+static int variables;
+
+static void deadList( TreeNode * t );
+
+/* Function returns tells whether statement t
+ * always ends in a return
+ */
+static int returns( TreeNode * t )
+{ if ((t == NULL) || (t->nodekind != StmtK)) return FALSE;
+  switch (t->kind.stmt) {
+    case RetK :
+      return TRUE;
+    case CompK :
+      for (t = t->child[1]; t != NULL; t = t->sibling)
+        if (returns(t)) return TRUE;
+      return FALSE;
+    case IfK :
+      return returns(t->child[1]) && returns(t->child[2]);
+    default :
+      return FALSE;
+  }
+}
+
+/* Procedure deadDecls removes the unused local
+ * declarations of compound statement t
+ */
+static void deadDecls( TreeNode * t )
+{ TreeNode * p, * last = NULL;
+  scope_push(t->attr.scope);
+  for (p = t->child[0]; p != NULL; p = p->sibling)
+    if ((p->nodekind == DeclK) && isUnusedDecl(p)) variables++;
+    else
+    { if (last == NULL) t->child[0] = p; else last->sibling = p;
+      last = p;
+    }
+  if (last == NULL) t->child[0] = NULL; else last->sibling = NULL;
+  scope_pop(-1);
+}
+
+/* Procedure deadNode removes the dead code in the
+ * subtrees of t
+ */
+static void deadNode( TreeNode * t )
+{ int i;
+  if ((t->nodekind == StmtK) && (t->kind.stmt == CompK)) deadDecls(t);
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (t->child[i] != NULL) deadList(t->child[i]);
+}
+
+/* Procedure deadList removes the dead code in the
+ * sibling list t, cutting it after the first
+ * statement that always returns
+ */
+static void deadList( TreeNode * t )
+{ TreeNode * p;
+  for (; t != NULL; t = t->sibling)
+  { deadNode(t);
+    if (returns(t) && (t->sibling != NULL))
+    { for (p = t->sibling; p != NULL; p = p->sibling) statements++;
+      t->sibling = NULL;
+    }
+  }
+}
+
+/* Procedure removeDead removes the statements that
+ * can never be executed and the unused local
+ * declarations from the syntax tree
+ */
+void removeDead( TreeNode * syntaxTree )
+{ statements = 0;
+  variables = 0;
+  deadList(syntaxTree);
+  if (TraceOpt)
+    fprintf(listing,"\nDead code: %d statements after return removed,"
+                    " %d unused variables removed\n",statements,variables);
+}
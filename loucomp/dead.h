@@ -0,0 +1,18 @@
+/****************************************************/
+/* File: dead.h                                     */
+/* Dead code elimination on the syntax tree         */
+/* for the C-Minus compiler                         */
+/****************************************************/
+
+#ifndef _DEAD_H_
+#define _DEAD_H_
+
+/* Procedure removeDead removes the statements that
+ * follow a return (or a statement that always
+ * returns) and the declarations of local variables
+ * that are never referenced from the (type checked)
+ * syntax tree
+ */
+void removeDead(TreeNode *);
+
+#endif
@@ -0,0 +1,178 @@
+/****************************************************/
+/* File: fold.c                                     */
+/* Constant folding on the syntax tree              */
+/* for the C-Minus compiler                         */
+/****************************************************/
+
+#include "globals.h"
+#include "fold.h"
+#include <limits.h>
+
+/* counts for the TraceOpt report */
+static int folded;
+static int pruned;
+
+static TreeNode * foldList( TreeNode * t );
+
+/* Function isConst tells whether t is the constant val */
+static int isConst( TreeNode * t, int val )
+{ return (t->nodekind == ExpK) && (t->kind.exp == ConstK)
+         && (t->attr.val == val);
+}
+
+/* Function canDrop tells whether the code for t may
+ * be left out: it has no side effect and cannot stop
+ * the TM (by a division by zero or an array index
+ * out of range)
+ */
+static int canDrop( TreeNode * t )
+{ if (t->nodekind != ExpK) return FALSE;
+  switch (t->kind.exp) {
+    case ConstK :
+    case IdK :
+      return TRUE;
+    case OpK :
+      return (t->attr.op != OVER)
+             && canDrop(t->child[0]) && canDrop(t->child[1]);
+    default :
+      return FALSE;
+  }
+}
+
+/* Procedure makeConst turns t into the constant val */
+static void makeConst( TreeNode * t, int val )
+{ t->kind.exp = ConstK;
+  t->attr.val = val;
+  t->child[0] = NULL;
+  t->child[1] = NULL;
+  t->type = Integer;
+  folded++;
+}
+
+/* Function foldOp folds the operator node t, whose
+ * operands are already folded, and returns the tree
+ * replacing it
+ */
+static TreeNode * foldOp( TreeNode * t )
+{ TreeNode * l = t->child[0], * r = t->child[1];
+  int a, b;
+  if ((l->kind.exp == ConstK) && (r->kind.exp == ConstK))
+  { /* evaluate as the TM does (+, - and * wrap around,
+       so they are done unsigned, where C defines the
+       overflow), but leave a division by zero to stop
+       the program at run time, and INT_MIN / -1, which
+       would trap in the compiler */
+    a = l->attr.val;
+    b = r->attr.val;
+    switch (t->attr.op) {
+      case PLUS :  makeConst(t,(int) ((unsigned) a + (unsigned) b)); break;
+      case MINUS : makeConst(t,(int) ((unsigned) a - (unsigned) b)); break;
+      case TIMES : makeConst(t,(int) ((unsigned) a * (unsigned) b)); break;
+      case OVER :
+        if ((b != 0) && !((a == INT_MIN) && (b == -1)))
+          makeConst(t,a / b);
+        break;
+      case LT :    makeConst(t,a < b); break;
+      case LE :    makeConst(t,a <= b); break;
+      case GT :    makeConst(t,a > b); break;
+      case GE :    makeConst(t,a >= b); break;
+      case EQ :    makeConst(t,a == b); break;
+      case NE :    makeConst(t,a != b); break;
+      default :    break;
+    }
+    return t;
+  }
+  switch (t->attr.op) {
+    case PLUS :
+      /* x+0, 0+x */
+      if (isConst(r,0)) { folded++; return l; }
+      if (isConst(l,0)) { folded++; return r; }
+      break;
+    case MINUS :
+      /* x-0 */
+      if (isConst(r,0)) { folded++; return l; }
+      break;
+    case TIMES :
+      /* x*1, 1*x, x*0, 0*x */
+      if (isConst(r,1)) { folded++; return l; }
+      if (isConst(l,1)) { folded++; return r; }
+      if ((isConst(r,0) && canDrop(l)) || (isConst(l,0) && canDrop(r)))
+        makeConst(t,0);
+      break;
+    case OVER :
+      /* x/1 */
+      if (isConst(r,1)) { folded++; return l; }
+      break;
+    default :
+      break;
+  }
+  return t;
+}
+
+/* Function foldNode folds the subtrees of t and
+ * returns the tree replacing t (NULL if t is
+ * removed); the sibling of the result is set by
+ * the caller
+ */
+static TreeNode * foldNode( TreeNode * t )
+{ TreeNode * test;
+  int i;
+  for (i = 0; i < MAXCHILDREN; i++)
+    t->child[i] = foldList(t->child[i]);
+  if ((t->nodekind == ExpK) && (t->kind.exp == OpK))
+    return foldOp(t);
+  if (t->nodekind != StmtK) return t;
+  test = t->child[0];
+  switch (t->kind.stmt) {
+    case IfK :
+      /* keep only the part that is executed */
+      if ((test != NULL) && (test->kind.exp == ConstK))
+      { pruned++;
+        return test->attr.val != 0 ? t->child[1] : t->child[2];
+      }
+      break;
+    case IterK :
+      /* a loop that is never entered */
+      if ((test != NULL) && isConst(test,0))
+      { pruned++;
+        return NULL;
+      }
+      break;
+    default :
+      break;
+  }
+  return t;
+}
+
+/* Function foldList folds each tree of the sibling
+ * list t and returns the new list
+ */
+static TreeNode * foldList( TreeNode * t )
+{ TreeNode * head = NULL, * last = NULL, * next, * r;
+  while (t != NULL)
+  { next = t->sibling;
+    t->sibling = NULL;
+    r = foldNode(t);
+    if (r != NULL)
+    { if (last == NULL) head = r; else last->sibling = r;
+      last = r;
+      while (last->sibling != NULL) last = last->sibling;
+    }
+    t = next;
+  }
+  return head;
+}
+
+/* Procedure foldConst folds constant expressions,
+ * simplifies algebraic identities and prunes if and
+ * while statements with constant tests in the
+ * (type checked) syntax tree
+ */
+void foldConst( TreeNode * syntaxTree )
+{ folded = 0;
+  pruned = 0;
+  foldList(syntaxTree);
+  if (TraceOpt)
+    fprintf(listing,"\nConstant folding: %d expressions folded,"
+                    " %d statements pruned\n",folded,pruned);
+}
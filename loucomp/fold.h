@@ -0,0 +1,17 @@
+/****************************************************/
+/* File: fold.h                                     */
+/* Constant folding on the syntax tree              */
+/* for the C-Minus compiler                         */
+/****************************************************/
+
+#ifndef _FOLD_H_
+#define _FOLD_H_
+
+/* Procedure foldConst folds constant expressions,
+ * simplifies algebraic identities and prunes if and
+ * while statements with constant tests in the
+ * (type checked) syntax tree
+ */
+void foldConst(TreeNode *);
+
+#endif
@@ -15,6 +15,8 @@
 #include <ctype.h>
 #include <string.h>
 
+#include "arena.h"
+
 /* Yacc/Bison generates internally its own values
  * for the tokens. Other files can access these values
  * by including the tab.h file generated using the
@@ -100,8 +102,16 @@ typedef struct treeNode
              ArrayAttr arr;
              struct ScopeListRec * scope; } attr;
      ExpType type; /* for type checking of exps */
+     int memloc; /* for code generation: data location of a
+                    declaration (gp-relative if >= 0, else
+                    fp-relative), or code location of a function */
    } TreeNode;
 
+/* TreeArena holds the syntax tree nodes and the
+ * strings they refer to, until code is generated
+ */
+extern Arena TreeArena;
+
 
 /**************************************************/
 /***********   Flags for tracing       ************/
@@ -135,6 +145,62 @@ extern int TraceAnalyze;
  */
 extern int TraceCode;
 
+/* BinaryCode = TRUE causes a binary TM object
+ * image to be written next to the code file
+ */
+extern int BinaryCode;
+
+/* TraceOpt = TRUE causes the optimization passes
+ * to report what they did to the listing file
+ */
+extern int TraceOpt;
+
+/* ConstFold = TRUE causes constant expressions to
+ * be folded in the syntax tree before generating code
+ */
+extern int ConstFold;
+
+/* UseIR = TRUE causes the code to be generated
+ * through the three-address intermediate code
+ * (ir.h); FALSE generates it directly from the
+ * syntax tree (cgen.c)
+ */
+extern int UseIR;
+
+/* TraceMem = TRUE causes the memory used by the
+ * syntax tree to be reported to the listing file
+ */
+extern int TraceMem;
+
+/* ScanOnly = TRUE causes the source to be scanned
+ * but not parsed, and the speed of the scanner to be
+ * reported to the listing file
+ */
+extern int ScanOnly;
+
+/* TraceIR = TRUE causes the intermediate code to
+ * be printed to the listing file
+ */
+extern int TraceIR;
+
+/* Peephole selects the peephole optimizer patterns
+ * (PEEP_ flags in peep.h) applied to the TM code;
+ * 0 turns the peephole optimizer off
+ */
+extern int Peephole;
+
+/* IrOpt selects the optimization passes (OPT_ flags
+ * in ir.h) run on the intermediate code; 0 runs none.
+ * OPT_DCE also removes dead code from the syntax tree,
+ * and OPT_TAIL also applies to the tree code generator.
+ */
+extern int IrOpt;
+
+/* InlineLimit is the largest size (in syntax tree
+ * nodes) of a function body inlined at its calls
+ */
+extern int InlineLimit;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error;
 #endif
@@ -0,0 +1,112 @@
+/****************************************************/
+/* File: intern.c                                   */
+/* String interning for the C-Minus compiler        */
+/****************************************************/
+
+#include <stddef.h>
+#include "globals.h"
+#include "intern.h"
+
+/* an interned string, found from the hash table by
+   its hash */
+typedef struct InternRec
+   { struct InternRec * next;
+     unsigned hash;
+     int len;
+     char text[1];
+   } * Intern;
+
+/* the hash table, which doubles when it holds as
+   many strings as it has buckets */
+static Intern * table = NULL;
+static int tableSize = 0;
+static int count = 0;
+static long lookups = 0;
+
+static void internOutOfMemory( void )
+{ fprintf(listing,"Out of memory error at line %d\n",lineno);
+  exit(1);
+}
+
+/* the FNV-1a hash function */
+static unsigned hashText( char * s, int len )
+{ unsigned h = 2166136261u;
+  for (; len > 0; s++, len--)
+  { h ^= (unsigned char) *s;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/* Procedure grow doubles the hash table */
+static void grow( void )
+{ int newSize = (tableSize == 0) ? 256 : 2 * tableSize;
+  Intern * newTable = (Intern *) calloc(newSize,sizeof(Intern));
+  Intern p, next;
+  int i;
+  if (newTable == NULL) internOutOfMemory();
+  for (i = 0; i < tableSize; i++)
+    for (p = table[i]; p != NULL; p = next)
+    { next = p->next;
+      p->next = newTable[p->hash & (newSize - 1)];
+      newTable[p->hash & (newSize - 1)] = p;
+    }
+  free(table);
+  table = newTable;
+  tableSize = newSize;
+}
+
+/* Function internText returns the interned copy of
+ * the len characters at s, making it the first time
+ * they are seen
+ */
+char * internText( char * s, int len )
+{ unsigned h = hashText(s,len);
+  Intern p;
+  lookups++;
+  if (tableSize > 0)
+    for (p = table[h & (tableSize - 1)]; p != NULL; p = p->next)
+      if ((p->hash == h) && (p->len == len) && (memcmp(p->text,s,len) == 0))
+        return p->text;
+  if (count >= tableSize) grow();
+  p = (Intern) arenaAlloc(&TreeArena,sizeof(struct InternRec) + len);
+  if (p == NULL) internOutOfMemory();
+  p->hash = h;
+  p->len = len;
+  memcpy(p->text,s,len);
+  p->text[len] = '\0';
+  p->next = table[h & (tableSize - 1)];
+  table[h & (tableSize - 1)] = p;
+  count++;
+  return p->text;
+}
+
+/* Function internString returns the interned copy
+ * of s, making it the first time s is seen
+ */
+char * internString( char * s )
+{ return internText(s,strlen(s));
+}
+
+/* Function internHash returns the hash of the
+ * interned string s, stored before its text
+ */
+unsigned internHash( char * s )
+{ return ((Intern) (s - offsetof(struct InternRec,text)))->hash;
+}
+
+/* Procedure internFree forgets all interned strings */
+void internFree( void )
+{ free(table);
+  table = NULL;
+  tableSize = count = 0;
+  lookups = 0;
+}
+
+/* Procedure internStats prints the number of
+ * interned strings and of lookups to the listing
+ */
+void internStats( void )
+{ fprintf(listing,"Identifiers: %d distinct names for %ld occurrences\n",
+          count,lookups);
+}
@@ -0,0 +1,40 @@
+/****************************************************/
+/* File: intern.h                                   */
+/* String interning for the C-Minus compiler        */
+/****************************************************/
+
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+/* Identifiers are interned: each distinct name is
+ * kept once (in TreeArena), together with its hash,
+ * so names can be compared by pointer.
+ */
+
+/* Function internString returns the interned copy
+ * of s, making it the first time s is seen
+ */
+char * internString( char * s );
+
+/* Function internText returns the interned copy of
+ * the len characters at s (which need not be null
+ * terminated)
+ */
+char * internText( char * s, int len );
+
+/* Function internHash returns the hash of the
+ * interned string s
+ */
+unsigned internHash( char * s );
+
+/* Procedure internFree forgets all interned strings;
+ * their memory goes with TreeArena
+ */
+void internFree( void );
+
+/* Procedure internStats prints the number of
+ * interned strings and of lookups to the listing
+ */
+void internStats( void );
+
+#endif
@@ -0,0 +1,961 @@
+/****************************************************/
+/* File: ir.c                                       */
+/* Three-address intermediate representation        */
+/* for the C-Minus compiler: construction from the  */
+/* syntax tree, utilities and printing              */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "ir.h"
+#include "cgen.h"
+
+/* globalOffset is the next free gp-relative
+   location for a global variable
+*/
+static int globalOffset = 0;
+
+/* the function being built, the block instructions
+   are added to (NULL after a jump or return) */
+static IrFunc * curFunc = NULL;
+static IrBlock * curBlock = NULL;
+static IrBlock * lastBlock = NULL;
+
+/* vregDecl holds the declaration of the variable
+   each vreg of curFunc stands for (NULL for temps);
+   the vreg of a scalar local or parameter is kept
+   in the memloc of its declaration */
+static TreeNode ** vregDecl = NULL;
+static int vregDeclSize = 0;
+
+/* while the body of a function is inlined, the
+   block its returns jump to and the vreg they set
+   (inlineExit is NULL otherwise) */
+static IrBlock * inlineExit = NULL;
+static int inlineResult = NO_VREG;
+
+/* the calls inlined, the functions they were
+   inlined into and the line of the call site in
+   that function (the outermost call when a call
+   in an inlined body is inlined too), for the
+   TraceOpt report */
+typedef struct
+   { TreeNode * call, * into;
+     int lineno;
+   } INLINED;
+
+static INLINED * inlined = NULL;
+static int ninlined = 0, maxinlined = 0;
+static int inlineLine = 0;
+
+/* the block after the entry of curFunc, which a
+   call of curFunc to itself in a return jumps to,
+   and the number of such calls, for the TraceOpt
+   report */
+static IrBlock * tailEntry = NULL;
+static int ntailcalls = 0;
+
+static void irOutOfMemory( void )
+{ fprintf(listing,"Out of memory error in IR construction\n");
+  exit(1);
+}
+
+/**************************************************/
+/***********   IR utilities            ************/
+/**************************************************/
+
+/* Function irNewInstr creates an unlinked instruction */
+IrInstr * irNewInstr( IrOp op, int d, int a, int b, int lineno )
+{ IrInstr * in = (IrInstr *) calloc(1,sizeof(IrInstr));
+  if (in == NULL) irOutOfMemory();
+  in->op = op;
+  in->d = d;
+  in->a = a;
+  in->b = b;
+  in->lineno = lineno;
+  return in;
+}
+
+/* Procedure irInsertBefore adds instruction in to
+ * block blk before instruction at (at the end if
+ * at is NULL)
+ */
+void irInsertBefore( IrBlock * blk, IrInstr * at, IrInstr * in )
+{ in->next = at;
+  in->prev = (at == NULL) ? blk->last : at->prev;
+  if (in->prev == NULL) blk->first = in; else in->prev->next = in;
+  if (at == NULL) blk->last = in; else at->prev = in;
+}
+
+/* Procedure irRemove takes instruction in out of blk */
+void irRemove( IrBlock * blk, IrInstr * in )
+{ if (in->prev == NULL) blk->first = in->next;
+  else in->prev->next = in->next;
+  if (in->next == NULL) blk->last = in->prev;
+  else in->next->prev = in->prev;
+  in->prev = in->next = NULL;
+}
+
+/* Function irNewVreg adds a vreg to f, holding
+ * variable name (NULL for a temporary)
+ */
+int irNewVreg( IrFunc * f, char * name )
+{ if (f->nvregs == f->maxvregs)
+  { f->maxvregs = f->maxvregs == 0 ? 64 : 2 * f->maxvregs;
+    f->vregName = (char **) realloc(f->vregName,
+                                    f->maxvregs * sizeof(char *));
+    if (f->vregName == NULL) irOutOfMemory();
+  }
+  f->vregName[f->nvregs] = name;
+  return f->nvregs++;
+}
+
+/* Procedure irLinkBlocks recomputes the
+ * predecessors of the blocks of f
+ */
+void irLinkBlocks( IrFunc * f )
+{ IrBlock * b;
+  IrInstr * t;
+  for (b = f->entry; b != NULL; b = b->next)
+  { free(b->pred);
+    b->pred = NULL;
+    b->npred = 0;
+  }
+  /* count, then fill */
+  for (b = f->entry; b != NULL; b = b->next)
+  { t = b->last;
+    if (t->t1 != NULL) t->t1->npred++;
+    if ((t->t2 != NULL) && (t->t2 != t->t1)) t->t2->npred++;
+  }
+  for (b = f->entry; b != NULL; b = b->next)
+  { if (b->npred > 0)
+    { b->pred = (IrBlock **) malloc(b->npred * sizeof(IrBlock *));
+      if (b->pred == NULL) irOutOfMemory();
+    }
+    b->npred = 0;
+  }
+  for (b = f->entry; b != NULL; b = b->next)
+  { t = b->last;
+    if (t->t1 != NULL) t->t1->pred[t->t1->npred++] = b;
+    if ((t->t2 != NULL) && (t->t2 != t->t1))
+      t->t2->pred[t->t2->npred++] = b;
+  }
+}
+
+/* Procedure markReachable marks in seen the labels
+ * of the blocks reachable from b
+ */
+static void markReachable( IrBlock * b, char * seen )
+{ while ((b != NULL) && !seen[b->label])
+  { seen[b->label] = TRUE;
+    if (b->last->t2 != NULL) markReachable(b->last->t2,seen);
+    b = b->last->t1;
+  }
+}
+
+/* Procedure irRemoveUnreachable removes the blocks
+ * of f that cannot be reached from its entry
+ */
+void irRemoveUnreachable( IrFunc * f )
+{ char * seen = (char *) calloc(f->nlabels,1);
+  IrBlock * b, * prev = NULL;
+  if (seen == NULL) irOutOfMemory();
+  markReachable(f->entry,seen);
+  for (b = f->entry; b != NULL; b = b->next)
+    if (seen[b->label])
+    { if (prev != NULL) prev->next = b;
+      prev = b;
+    }
+  prev->next = NULL;
+  free(seen);
+  irLinkBlocks(f);
+}
+
+/* Procedure irMergeBlocks joins each block that
+ * jumps to a block with no other predecessor with
+ * that block
+ */
+void irMergeBlocks( IrFunc * f )
+{ IrBlock * b, * s, * p;
+  IrInstr * in;
+  for (b = f->entry; b != NULL; b = b->next)
+    while ((b->last->op == IR_JUMP) && ((s = b->last->t1) != b)
+           && (s != f->entry) && (s->npred == 1))
+    { in = b->last;
+      irRemove(b,in);
+      free(in);
+      while ((in = s->first) != NULL)
+      { irRemove(s,in);
+        irInsertBefore(b,NULL,in);
+      }
+      for (p = f->entry; p->next != s; p = p->next) ;
+      p->next = s->next;
+      free(s->pred);
+      free(s->liveIn);
+      free(s->liveOut);
+      free(s);
+      irLinkBlocks(f);
+    }
+}
+
+/**************************************************/
+/***********   Construction            ************/
+/**************************************************/
+
+/* Function newBlock creates a block of curFunc,
+ * which is laid out when startBlock is called
+ */
+static IrBlock * newBlock( void )
+{ IrBlock * b = (IrBlock *) calloc(1,sizeof(IrBlock));
+  if (b == NULL) irOutOfMemory();
+  b->label = curFunc->nlabels++;
+  return b;
+}
+
+/* Procedure startBlock lays out block b next and
+ * adds the instructions that follow to it; the
+ * current block falls through to it
+ */
+static void emitInstr( IrInstr * in );
+static void startBlock( IrBlock * b )
+{ IrInstr * in;
+  if (curBlock != NULL)
+  { in = irNewInstr(IR_JUMP,NO_VREG,NO_VREG,NO_VREG,
+                    curBlock->last == NULL ? 0 : curBlock->last->lineno);
+    in->t1 = b;
+    emitInstr(in);
+  }
+  if (lastBlock == NULL) curFunc->entry = b;
+  else lastBlock->next = b;
+  lastBlock = b;
+  curBlock = b;
+}
+
+/* Procedure emitInstr adds instruction in to the
+ * current block; code after a jump or return goes
+ * to a new (unreachable) block
+ */
+static void emitInstr( IrInstr * in )
+{ if (curBlock == NULL) startBlock(newBlock());
+  irInsertBefore(curBlock,NULL,in);
+  if ((in->op == IR_JUMP) || (in->op == IR_BRANCH) || (in->op == IR_RET))
+    curBlock = NULL;
+}
+
+/* Function emit3 adds an instruction d = a op b */
+static IrInstr * emit3( IrOp op, int d, int a, int b, int lineno )
+{ IrInstr * in = irNewInstr(op,d,a,b,lineno);
+  emitInstr(in);
+  return in;
+}
+
+/* Function newVreg returns a new vreg of curFunc for
+ * the variable declared by decl (NULL for a temp)
+ */
+static int newVreg( TreeNode * decl )
+{ int v = irNewVreg(curFunc,decl == NULL ? NULL : decl->attr.name);
+  if (v >= vregDeclSize)
+  { vregDeclSize = curFunc->maxvregs;
+    vregDecl = (TreeNode **) realloc(vregDecl,
+                                     vregDeclSize * sizeof(TreeNode *));
+    if (vregDecl == NULL) irOutOfMemory();
+  }
+  vregDecl[v] = decl;
+  if (decl != NULL) decl->memloc = v;
+  return v;
+}
+
+/* Function newTemp returns a new temporary vreg */
+static int newTemp( void )
+{ return newVreg(NULL);
+}
+
+/* Function varOf returns the vreg of the variable
+ * declared by decl, or NO_VREG if it lives in memory
+ */
+static int varOf( TreeNode * decl )
+{ int v = decl->memloc;
+  if ((v >= 0) && (v < curFunc->nvregs) && (vregDecl[v] == decl))
+    return v;
+  return NO_VREG;
+}
+
+/* Function isVar tells whether vreg v holds a variable */
+static int isVar( int v )
+{ return (v != NO_VREG) && (vregDecl[v] != NULL);
+}
+
+/* Function hasAssign tells whether the evaluation
+ * of tree may assign a variable held in a vreg
+ */
+static int hasAssign( TreeNode * tree )
+{ int i;
+  if (tree == NULL) return FALSE;
+  if ((tree->nodekind == ExpK) && (tree->kind.exp == AssignK))
+    return TRUE;
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (hasAssign(tree->child[i])) return TRUE;
+  return hasAssign(tree->sibling);
+}
+
+/* Function stable returns v, or a copy of it if v
+ * is a variable that the evaluation of later may
+ * assign before the value of v is used
+ */
+static int stable( int v, TreeNode * later, int lineno )
+{ int t;
+  if (!isVar(v) || !hasAssign(later)) return v;
+  t = newTemp();
+  emit3(IR_COPY,t,v,NO_VREG,lineno);
+  return t;
+}
+
+static int genExp( TreeNode * tree );
+static int genElemAddr( TreeNode * tree );
+
+/* Procedure genPair generates the instructions for
+ * two operands (element addresses if addr1/addr2
+ * are TRUE) and returns their vregs in *v1 and *v2
+ */
+static void genPair( TreeNode * t1, int addr1, TreeNode * t2, int addr2,
+                     int lineno, int * v1, int * v2 )
+{ if (regNeed(t2,addr2) > regNeed(t1,addr1))
+  { *v2 = addr2 ? genElemAddr(t2) : genExp(t2);
+    *v2 = stable(*v2,t1,lineno);
+    *v1 = addr1 ? genElemAddr(t1) : genExp(t1);
+  }
+  else
+  { *v1 = addr1 ? genElemAddr(t1) : genExp(t1);
+    *v1 = stable(*v1,t2,lineno);
+    *v2 = addr2 ? genElemAddr(t2) : genExp(t2);
+  }
+}
+
+/* Function genArrayBase returns a vreg holding the
+ * address of the array declared by decl
+ */
+static int genArrayBase( TreeNode * decl, int lineno )
+{ int v = varOf(decl), d;
+  IrInstr * in;
+  if (v != NO_VREG) return v;  /* array parameter */
+  d = newTemp();
+  in = emit3(IR_ADDR,d,NO_VREG,NO_VREG,lineno);
+  in->var = decl;
+  in->imm = decl->memloc;
+  return d;
+}
+
+/* Function genElemAddr returns a vreg holding the
+ * address of the array element tree refers to
+ */
+static int genElemAddr( TreeNode * tree )
+{ TreeNode * decl = lookupDecl(tree->attr.name);
+  int i = genExp(tree->child[0]);
+  int base = genArrayBase(decl,tree->lineno);
+  int d = newTemp();
+  emit3(IR_ADD,d,base,i,tree->lineno);
+  return d;
+}
+
+static void genStmt( TreeNode * tree );
+
+/* Function treeSize returns the number of nodes in
+ * the tree list t
+ */
+static int treeSize( TreeNode * t )
+{ int n = 0, i;
+  for (; t != NULL; t = t->sibling)
+  { n++;
+    for (i = 0; i < MAXCHILDREN; i++) n += treeSize(t->child[i]);
+  }
+  return n;
+}
+
+/* Function callsTo tells whether the tree list t
+ * contains a call to the function named name
+ */
+static int callsTo( TreeNode * t, char * name )
+{ int i;
+  for (; t != NULL; t = t->sibling)
+  { if ((t->nodekind == ExpK) && (t->kind.exp == CallK)
+        && (strcmp(t->attr.name,name) == 0))
+      return TRUE;
+    for (i = 0; i < MAXCHILDREN; i++)
+      if (callsTo(t->child[i],name)) return TRUE;
+  }
+  return FALSE;
+}
+
+/* Function canInline tells whether the calls to
+ * func are replaced by its body: it must have at
+ * most InlineLimit nodes and not call itself (a
+ * function can only call the ones declared before
+ * it, so there is no other recursion)
+ */
+static int canInline( TreeNode * func )
+{ return (IrOpt & OPT_INLINE) && (func->child[2] != NULL)
+         && (treeSize(func->child[2]) <= InlineLimit)
+         && !callsTo(func->child[2],func->attr.name);
+}
+
+/* Function genInline generates the body of func in
+ * place of call tree, whose arguments have been
+ * evaluated into args, and returns the vreg holding
+ * its value (NO_VREG for a void function)
+ */
+static int genInline( TreeNode * tree, TreeNode * func, int * args )
+{ IrBlock * savedExit = inlineExit, * exit = newBlock();
+  int savedResult = inlineResult, d = NO_VREG, i = 0;
+  TreeNode * p;
+  if (func->type != Void) d = newTemp();
+  /* the parameters are new variables set to the
+     arguments */
+  for (p = func->child[1]; p != NULL; p = p->sibling)
+    if (p->nodekind == ParamK)
+      emit3(IR_COPY,newVreg(p),args[i++],NO_VREG,tree->lineno);
+  if (savedExit == NULL) inlineLine = tree->lineno;
+  inlineExit = exit;
+  inlineResult = d;
+  genStmt(func->child[2]);
+  inlineExit = savedExit;
+  inlineResult = savedResult;
+  startBlock(exit);
+  if (ninlined == maxinlined)
+  { maxinlined = maxinlined == 0 ? 16 : 2 * maxinlined;
+    inlined = (INLINED *) realloc(inlined,maxinlined * sizeof(INLINED));
+    if (inlined == NULL) irOutOfMemory();
+  }
+  inlined[ninlined].call = tree;
+  inlined[ninlined].into = curFunc->decl;
+  inlined[ninlined++].lineno = inlineLine;
+  return d;
+}
+
+/* Function genCall returns the vreg holding the
+ * value of a call (NO_VREG for a void function)
+ */
+static int genCall( TreeNode * tree )
+{ TreeNode * func = lookupDecl(tree->attr.name);
+  TreeNode * arg;
+  IrInstr * in;
+  int nargs = 0, i, d = NO_VREG;
+  int * args;
+  if (strcmp(tree->attr.name,"input") == 0)
+  { d = newTemp();
+    emit3(IR_IN,d,NO_VREG,NO_VREG,tree->lineno);
+    return d;
+  }
+  if (strcmp(tree->attr.name,"output") == 0)
+  { emit3(IR_OUT,NO_VREG,genExp(tree->child[0]),NO_VREG,tree->lineno);
+    return NO_VREG;
+  }
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+    nargs++;
+  args = (int *) malloc((nargs + 1) * sizeof(int));
+  if (args == NULL) irOutOfMemory();
+  /* evaluate all the arguments before passing them,
+     as they may contain calls themselves */
+  for (arg = tree->child[0], i = 0; arg != NULL; arg = arg->sibling, i++)
+    args[i] = stable(genExp(arg),arg->sibling,arg->lineno);
+  if (canInline(func))
+  { d = genInline(tree,func,args);
+    free(args);
+    return d;
+  }
+  for (i = 0; i < nargs; i++)
+  { in = emit3(IR_ARG,NO_VREG,args[i],NO_VREG,tree->lineno);
+    in->imm = i;
+  }
+  free(args);
+  if (func->type != Void) d = newTemp();
+  in = emit3(IR_CALL,d,NO_VREG,NO_VREG,tree->lineno);
+  in->var = func;
+  return d;
+}
+
+/* Function isTailCall tells whether expression
+ * tree, returned by curFunc, is a call of curFunc
+ * itself that can be replaced by a jump
+ */
+static int isTailCall( TreeNode * tree )
+{ return (IrOpt & OPT_TAIL) && (inlineExit == NULL) && (tree != NULL)
+         && (tree->nodekind == ExpK) && (tree->kind.exp == CallK)
+         && (lookupDecl(tree->attr.name) == curFunc->decl)
+         && !passesLocalArray(tree);
+}
+
+/* Procedure genTailCall generates a call of curFunc
+ * to itself in a return as the assignment of the
+ * arguments to the parameters and a jump back to
+ * the start of the body
+ */
+static void genTailCall( TreeNode * tree )
+{ TreeNode * arg;
+  IrInstr * in;
+  int nargs = 0, i, t;
+  int * args;
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+    nargs++;
+  args = (int *) malloc((nargs + 1) * sizeof(int));
+  if (args == NULL) irOutOfMemory();
+  for (arg = tree->child[0], i = 0; arg != NULL; arg = arg->sibling, i++)
+    args[i] = stable(genExp(arg),arg->sibling,arg->lineno);
+  /* the parameters are vregs 0 .. nargs-1 and are
+     assigned in order, so an argument that is an
+     earlier parameter must be saved first */
+  for (i = 0; i < nargs; i++)
+    if ((args[i] < i) && (args[i] != NO_VREG))
+    { t = newTemp();
+      emit3(IR_COPY,t,args[i],NO_VREG,tree->lineno);
+      args[i] = t;
+    }
+  for (i = 0; i < nargs; i++)
+    if (args[i] != i)
+      emit3(IR_COPY,i,args[i],NO_VREG,tree->lineno);
+  free(args);
+  in = emit3(IR_JUMP,NO_VREG,NO_VREG,NO_VREG,tree->lineno);
+  in->t1 = tailEntry;
+  ntailcalls++;
+}
+
+/* Function genExp generates the instructions for
+ * an expression and returns the vreg holding its
+ * value
+ */
+static int genExp( TreeNode * tree )
+{ TreeNode * decl;
+  IrInstr * in;
+  int a, b, d, v;
+  switch (tree->kind.exp) {
+
+    case ConstK :
+      d = newTemp();
+      in = emit3(IR_CONST,d,NO_VREG,NO_VREG,tree->lineno);
+      in->imm = tree->attr.val;
+      return d;
+
+    case IdK :
+      decl = lookupDecl(tree->attr.name);
+      v = varOf(decl);
+      if (v != NO_VREG) return v;
+      if ((decl->nodekind == DeclK) && (decl->kind.decl == ArrVarK))
+        /* the value of an array name is its address */
+        return genArrayBase(decl,tree->lineno);
+      d = newTemp();
+      in = emit3(IR_GLOAD,d,NO_VREG,NO_VREG,tree->lineno);
+      in->var = decl;
+      return d;
+
+    case ArrIdK :
+      a = genElemAddr(tree);
+      d = newTemp();
+      emit3(IR_LOAD,d,a,NO_VREG,tree->lineno);
+      return d;
+
+    case CallK :
+      return genCall(tree);
+
+    case AssignK :
+      if (tree->child[0]->kind.exp == ArrIdK)
+      { genPair(tree->child[1],FALSE,tree->child[0],TRUE,tree->lineno,&b,&a);
+        emit3(IR_STORE,NO_VREG,a,b,tree->lineno);
+        return b;
+      }
+      b = genExp(tree->child[1]);
+      decl = lookupDecl(tree->child[0]->attr.name);
+      v = varOf(decl);
+      if (v == NO_VREG)
+      { in = emit3(IR_GSTORE,NO_VREG,b,NO_VREG,tree->lineno);
+        in->var = decl;
+        return b;
+      }
+      in = curBlock == NULL ? NULL : curBlock->last;
+      if (!isVar(b) && (in != NULL) && (in->d == b))
+        /* compute the value straight into the variable */
+        in->d = v;
+      else
+        emit3(IR_COPY,v,b,NO_VREG,tree->lineno);
+      return v;
+
+    case OpK :
+      genPair(tree->child[0],FALSE,tree->child[1],FALSE,tree->lineno,&a,&b);
+      d = newTemp();
+      switch (tree->attr.op) {
+        case PLUS :  emit3(IR_ADD,d,a,b,tree->lineno); break;
+        case MINUS : emit3(IR_SUB,d,a,b,tree->lineno); break;
+        case TIMES : emit3(IR_MUL,d,a,b,tree->lineno); break;
+        case OVER :  emit3(IR_DIV,d,a,b,tree->lineno); break;
+        default :
+          in = emit3(IR_CMP,d,a,b,tree->lineno);
+          in->rel = tree->attr.op;
+          break;
+      }
+      return d;
+
+    default :
+      return NO_VREG;
+  }
+}
+
+/* Procedure genCond generates the instructions
+ * that jump to block yes if tree is true and to
+ * block no otherwise
+ */
+static void genCond( TreeNode * tree, IrBlock * yes, IrBlock * no )
+{ IrInstr * in;
+  TreeNode * l = tree->child[0], * r = tree->child[1];
+  int a, b = NO_VREG;
+  TokenType rel = NE;
+  if ((tree->kind.exp == OpK) && (tree->attr.op != PLUS)
+      && (tree->attr.op != MINUS) && (tree->attr.op != TIMES)
+      && (tree->attr.op != OVER))
+  { rel = tree->attr.op;
+    if ((r->kind.exp == ConstK) && (r->attr.val == 0))
+      a = genExp(l);
+    else
+      genPair(l,FALSE,r,FALSE,tree->lineno,&a,&b);
+  }
+  else
+    a = genExp(tree);
+  in = emit3(IR_BRANCH,NO_VREG,a,b,tree->lineno);
+  in->rel = rel;
+  in->t1 = yes;
+  in->t2 = no;
+}
+
+static void genStmtList( TreeNode * tree );
+
+/* Procedure genDecl allocates a local variable */
+static void genDecl( TreeNode * tree )
+{ switch (tree->kind.decl) {
+    case VarK :
+      newVreg(tree);
+      break;
+    case ArrVarK :
+      curFunc->frameSize += tree->attr.arr.size;
+      tree->memloc = -2 - curFunc->frameSize + 1;
+      break;
+    default :
+      break;
+  }
+}
+
+/* Procedure genStmt generates the instructions for
+ * a statement
+ */
+static void genStmt( TreeNode * tree )
+{ IrBlock * b1, * b2, * b3;
+  TreeNode * p;
+  int a;
+  if (tree->nodekind == ExpK)
+  { genExp(tree);
+    return;
+  }
+  if (tree->nodekind == DeclK)
+  { genDecl(tree);
+    return;
+  }
+  switch (tree->kind.stmt) {
+
+    case CompK :
+      scope_push(tree->attr.scope);
+      for (p = tree->child[0]; p != NULL; p = p->sibling)
+        genDecl(p);
+      genStmtList(tree->child[1]);
+      scope_pop(-1);
+      break;
+
+    case IfK :
+      b1 = newBlock();
+      b3 = newBlock();
+      b2 = (tree->child[2] != NULL) ? newBlock() : b3;
+      genCond(tree->child[0],b1,b2);
+      startBlock(b1);
+      genStmtList(tree->child[1]);
+      if (tree->child[2] != NULL)
+      { if (curBlock != NULL)
+        { IrInstr * in = emit3(IR_JUMP,NO_VREG,NO_VREG,NO_VREG,tree->lineno);
+          in->t1 = b3;
+        }
+        startBlock(b2);
+        genStmtList(tree->child[2]);
+      }
+      startBlock(b3);
+      break;
+
+    case IterK :
+      /* the test is laid out after the body:
+         jump to the test, which loops back */
+      b1 = newBlock();
+      b2 = newBlock();
+      b3 = newBlock();
+      { IrInstr * in = emit3(IR_JUMP,NO_VREG,NO_VREG,NO_VREG,tree->lineno);
+        in->t1 = b2;
+      }
+      startBlock(b1);
+      genStmtList(tree->child[1]);
+      startBlock(b2);
+      genCond(tree->child[0],b1,b3);
+      startBlock(b3);
+      break;
+
+    case RetK :
+      if (isTailCall(tree->child[0]))
+      { genTailCall(tree->child[0]);
+        break;
+      }
+      a = (tree->child[0] == NULL) ? NO_VREG : genExp(tree->child[0]);
+      if (inlineExit == NULL)
+      { emit3(IR_RET,NO_VREG,a,NO_VREG,tree->lineno);
+        break;
+      }
+      /* in an inlined body: set the value of the call
+         and leave the body */
+      if ((inlineResult != NO_VREG) && (a != NO_VREG))
+      { IrInstr * in = curBlock == NULL ? NULL : curBlock->last;
+        if (!isVar(a) && (in != NULL) && (in->d == a))
+          in->d = inlineResult;
+        else
+          emit3(IR_COPY,inlineResult,a,NO_VREG,tree->lineno);
+      }
+      { IrInstr * in = emit3(IR_JUMP,NO_VREG,NO_VREG,NO_VREG,tree->lineno);
+        in->t1 = inlineExit;
+      }
+      break;
+
+    default :
+      break;
+  }
+}
+
+/* Procedure genStmtList generates the instructions
+ * for a list of statements
+ */
+static void genStmtList( TreeNode * tree )
+{ for (; tree != NULL; tree = tree->sibling)
+    genStmt(tree);
+}
+
+/* Function genFunc builds the IR of function tree */
+static IrFunc * genFunc( TreeNode * tree )
+{ IrFunc * f = (IrFunc *) calloc(1,sizeof(IrFunc));
+  TreeNode * p;
+  if (f == NULL) irOutOfMemory();
+  f->decl = tree;
+  curFunc = f;
+  curBlock = NULL;
+  lastBlock = NULL;
+  /* the parameters come first, in the locations the
+     caller stores them to */
+  for (p = tree->child[1]; p != NULL; p = p->sibling)
+    if (p->nodekind == ParamK)
+    { newVreg(p);
+      f->nparams++;
+    }
+  f->frameSize = f->nparams;
+  startBlock(newBlock());
+  /* the body gets a block of its own for tail calls
+     to jump to; it is merged into the entry if there
+     are none */
+  tailEntry = newBlock();
+  startBlock(tailEntry);
+  genStmt(tree->child[2]);
+  if (curBlock != NULL)
+    /* falling off the end returns */
+    emit3(IR_RET,NO_VREG,NO_VREG,NO_VREG,tree->lineno);
+  irRemoveUnreachable(f);
+  irMergeBlocks(f);
+  curFunc = NULL;
+  return f;
+}
+
+/* Function isCalled tells whether any function in
+ * funcs calls the function declared by decl
+ */
+static int isCalled( IrFunc * funcs, TreeNode * decl )
+{ IrBlock * b;
+  IrInstr * in;
+  for (; funcs != NULL; funcs = funcs->next)
+    for (b = funcs->entry; b != NULL; b = b->next)
+      for (in = b->first; in != NULL; in = in->next)
+        if ((in->op == IR_CALL) && (in->var == decl)) return TRUE;
+  return FALSE;
+}
+
+/* Function dropInlined removes from funcs the
+ * functions that were inlined at all their calls
+ * (but main, which the prelude calls) and returns
+ * the new list; *dropped is set to their number
+ */
+static IrFunc * dropInlined( IrFunc * funcs, int * dropped )
+{ IrFunc * f, * prev = NULL, * next;
+  int i;
+  *dropped = 0;
+  for (f = funcs; f != NULL; f = next)
+  { next = f->next;
+    for (i = 0; (i < ninlined) && (strcmp(inlined[i].call->attr.name,
+                                          f->decl->attr.name) != 0); i++) ;
+    if ((i < ninlined) && (strcmp(f->decl->attr.name,"main") != 0)
+        && !isCalled(funcs,f->decl))
+    { if (prev == NULL) funcs = next; else prev->next = next;
+      (*dropped)++;
+    }
+    else prev = f;
+  }
+  return funcs;
+}
+
+/* Function irBuild translates the (type checked)
+ * syntax tree into the intermediate representation,
+ * allocating the global variables. Returns the list
+ * of functions in declaration order.
+ */
+IrFunc * irBuild( TreeNode * syntaxTree )
+{ IrFunc * first = NULL, * last = NULL, * f;
+  TreeNode * t;
+  int i, dropped;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+  { if (t->nodekind != DeclK) continue;
+    switch (t->kind.decl) {
+      case FuncK :
+        f = genFunc(t);
+        if (last == NULL) first = f; else last->next = f;
+        last = f;
+        break;
+      case VarK :
+        t->memloc = globalOffset++;
+        break;
+      case ArrVarK :
+        t->memloc = globalOffset;
+        globalOffset += t->attr.arr.size;
+        break;
+      default :
+        break;
+    }
+  }
+  first = dropInlined(first,&dropped);
+  if (TraceOpt && (IrOpt & OPT_INLINE))
+  { fprintf(listing,"\nInlining: %d call sites inlined (limit %d nodes),"
+                    " %d functions no longer called\n",
+            ninlined,InlineLimit,dropped);
+    for (i = 0; i < ninlined; i++)
+      fprintf(listing,"   %s into %s at line %d\n",
+              inlined[i].call->attr.name,inlined[i].into->attr.name,
+              inlined[i].lineno);
+  }
+  if (TraceOpt && (IrOpt & OPT_TAIL))
+    fprintf(listing,"\nTail calls: %d self calls turned into jumps\n",
+            ntailcalls);
+  return first;
+}
+
+/**************************************************/
+/***********   Printing                ************/
+/**************************************************/
+
+/* Function vregText writes vreg v of f to buf */
+static char * vregText( char * buf, IrFunc * f, int v )
+{ if (v == NO_VREG) strcpy(buf,"0");
+  else if (f->vregName[v] != NULL)
+    sprintf(buf,"%.20s.%d",f->vregName[v],v);
+  else sprintf(buf,"t%d",v);
+  return buf;
+}
+
+static char * relText( TokenType rel )
+{ switch (rel) {
+    case LT : return "<";
+    case LE : return "<=";
+    case GT : return ">";
+    case GE : return ">=";
+    case EQ : return "==";
+    default : return "!=";
+  }
+}
+
+/* Procedure irFormat writes instruction in of f
+ * to buf as text
+ */
+void irFormat( char * buf, IrFunc * f, IrInstr * in )
+{ char d[32], a[32], b[32];
+  int i;
+  vregText(d,f,in->d);
+  vregText(a,f,in->a);
+  vregText(b,f,in->b);
+  switch (in->op) {
+    case IR_CONST : sprintf(buf,"%s = %d",d,in->imm); break;
+    case IR_COPY :  sprintf(buf,"%s = %s",d,a); break;
+    case IR_ADD :   sprintf(buf,"%s = %s + %s",d,a,b); break;
+    case IR_SUB :   sprintf(buf,"%s = %s - %s",d,a,b); break;
+    case IR_MUL :   sprintf(buf,"%s = %s * %s",d,a,b); break;
+    case IR_DIV :   sprintf(buf,"%s = %s / %s",d,a,b); break;
+    case IR_CMP :
+      sprintf(buf,"%s = %s %s %s",d,a,relText(in->rel),b);
+      break;
+    case IR_ADDR :
+      sprintf(buf,"%s = &%.20s",d,in->var->attr.arr.name);
+      break;
+    case IR_LOAD :  sprintf(buf,"%s = [%s]",d,a); break;
+    case IR_STORE : sprintf(buf,"[%s] = %s",a,b); break;
+    case IR_GLOAD : sprintf(buf,"%s = %.20s",d,in->var->attr.name); break;
+    case IR_GSTORE :
+      sprintf(buf,"%.20s = %s",in->var->attr.name,a);
+      break;
+    case IR_IN :    sprintf(buf,"%s = input",d); break;
+    case IR_OUT :   sprintf(buf,"output %s",a); break;
+    case IR_ARG :   sprintf(buf,"arg %d = %s",in->imm,a); break;
+    case IR_CALL :
+      if (in->d == NO_VREG)
+        sprintf(buf,"call %.20s",in->var->attr.name);
+      else
+        sprintf(buf,"%s = call %.20s",d,in->var->attr.name);
+      break;
+    case IR_JUMP :  sprintf(buf,"goto L%d",in->t1->label); break;
+    case IR_BRANCH :
+      sprintf(buf,"if %s %s %s goto L%d else L%d",a,relText(in->rel),b,
+              in->t1->label,in->t2->label);
+      break;
+    case IR_RET :
+      if (in->a == NO_VREG) strcpy(buf,"return");
+      else sprintf(buf,"return %s",a);
+      break;
+    case IR_PHI :
+      sprintf(buf,"%s = phi(",d);
+      for (i = 0; i < in->imm; i++)
+      { if (strlen(buf) > 80) { strcat(buf,"..."); break; }
+        if (i > 0) strcat(buf,", ");
+        strcat(buf,vregText(a,f,in->args[i]));
+      }
+      strcat(buf,")");
+      break;
+    default :       strcpy(buf,"?"); break;
+  }
+}
+
+/* Procedure irPrint prints the intermediate
+ * representation of the functions in f to the
+ * listing file
+ */
+void irPrint( IrFunc * f )
+{ IrBlock * b;
+  IrInstr * in;
+  char buf[120];
+  int i;
+  for (; f != NULL; f = f->next)
+  { fprintf(listing,"\nfunction %s (%d vregs)\n",f->decl->attr.name,
+            f->nvregs);
+    for (b = f->entry; b != NULL; b = b->next)
+    { fprintf(listing,"L%d:",b->label);
+      if (b->npred > 0)
+      { fprintf(listing,"%*s; preds",8,"");
+        for (i = 0; i < b->npred; i++)
+          fprintf(listing," L%d",b->pred[i]->label);
+      }
+      fprintf(listing,"\n");
+      for (in = b->first; in != NULL; in = in->next)
+      { irFormat(buf,f,in);
+        fprintf(listing,"%6d    %s\n",in->lineno,buf);
+      }
+    }
+  }
+}
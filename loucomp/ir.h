@@ -0,0 +1,156 @@
+/****************************************************/
+/* File: ir.h                                       */
+/* Three-address intermediate representation        */
+/* for the C-Minus compiler                         */
+/****************************************************/
+
+#ifndef _IR_H_
+#define _IR_H_
+
+/* The intermediate representation of a function is
+ * a list of basic blocks of three-address
+ * instructions over an unlimited number of virtual
+ * registers (vregs). Each block ends with exactly
+ * one IR_JUMP, IR_BRANCH or IR_RET; the blocks are
+ * kept in the order they are laid out in the code.
+ *
+ * The scalar parameters and local variables of a
+ * function live in vregs (C-Minus cannot take their
+ * address); global scalars and arrays live in
+ * memory and are accessed with loads and stores.
+ */
+
+typedef enum {
+   IR_CONST,   /* d = imm */
+   IR_COPY,    /* d = a */
+   IR_ADD,     /* d = a + b */
+   IR_SUB,     /* d = a - b */
+   IR_MUL,     /* d = a * b */
+   IR_DIV,     /* d = a / b */
+   IR_CMP,     /* d = (a rel b) ? 1 : 0 */
+   IR_ADDR,    /* d = address of array var, which is at
+                  location imm (gp-relative if >= 0, else
+                  fp-relative) */
+   IR_LOAD,    /* d = mem[a] */
+   IR_STORE,   /* mem[a] = b */
+   IR_GLOAD,   /* d = global scalar var */
+   IR_GSTORE,  /* global scalar var = a */
+   IR_IN,      /* d = input() */
+   IR_OUT,     /* output(a) */
+   IR_ARG,     /* argument imm of the next call = a */
+   IR_CALL,    /* d = var(arguments); d may be NO_VREG */
+   IR_JUMP,    /* goto t1 */
+   IR_BRANCH,  /* if (a rel b) goto t1 else goto t2;
+                  b may be NO_VREG, standing for 0 */
+   IR_RET,     /* return a; a may be NO_VREG */
+   IR_PHI      /* d = phi(args), one argument for each
+                  predecessor, in SSA form only (ssa.h) */
+   } IrOp;
+
+#define NO_VREG (-1)
+
+struct irBlock;
+
+typedef struct irInstr
+   { IrOp op;
+     int d, a, b;      /* vregs, or NO_VREG */
+     int imm;          /* IR_CONST value, IR_ADDR location,
+                          IR_ARG number, IR_PHI number of
+                          arguments */
+     TokenType rel;    /* IR_CMP, IR_BRANCH: LT..NE */
+     TreeNode * var;   /* IR_ADDR, IR_GLOAD, IR_GSTORE: the
+                          variable; IR_CALL: the function */
+     struct irBlock * t1, * t2; /* IR_JUMP, IR_BRANCH targets */
+     int * args;       /* IR_PHI arguments, in the order of the
+                          predecessors of the block */
+     int lineno;       /* source line */
+     struct irInstr * prev, * next;
+   } IrInstr;
+
+typedef struct irBlock
+   { int label;        /* printed as L<label> */
+     IrInstr * first, * last;
+     struct irBlock ** pred; /* predecessors, see irLinkBlocks */
+     int npred;
+     int loc;          /* code location, for the lowering */
+     struct irBlock * idom; /* immediate dominator, see irDominators */
+     int rpo;          /* reverse postorder number */
+     char * liveIn, * liveOut; /* the vregs live at the start and
+                          end of the block, see irLiveness */
+     struct irBlock * next;
+   } IrBlock;
+
+typedef struct irFunc
+   { TreeNode * decl;  /* the FuncK node */
+     IrBlock * entry;  /* first block */
+     int nvregs;
+     int maxvregs;     /* allocated size of vregName */
+     int nparams;      /* the parameters are vregs 0..nparams-1 */
+     char ** vregName; /* variable held by each vreg, or NULL
+                          for a temporary */
+     int frameSize;    /* locations taken by the parameters
+                          and local arrays below initFO */
+     int nlabels;
+     int * orig;       /* in SSA form, the vreg each vreg is a
+                          version of */
+     struct irFunc * next;
+   } IrFunc;
+
+/* Function irBuild translates the (type checked)
+ * syntax tree into the intermediate representation,
+ * allocating the global variables. Returns the list
+ * of functions in declaration order.
+ */
+IrFunc * irBuild( TreeNode * syntaxTree );
+
+/* Procedure irLinkBlocks recomputes the
+ * predecessors of the blocks of f
+ */
+void irLinkBlocks( IrFunc * f );
+
+/* Procedure irRemoveUnreachable removes the blocks
+ * of f that cannot be reached from its entry
+ */
+void irRemoveUnreachable( IrFunc * f );
+
+/* Procedure irMergeBlocks joins each block that
+ * jumps to a block with no other predecessor with
+ * that block
+ */
+void irMergeBlocks( IrFunc * f );
+
+/* Flags for the optimization passes on the IR,
+ * selected by IrOpt
+ */
+#define OPT_SCCP     1  /* sparse conditional constant propagation */
+#define OPT_DCE      2  /* dead code elimination */
+#define OPT_LOOP     4  /* loop invariant code motion */
+#define OPT_INLINE   8  /* inlining of small functions */
+#define OPT_TAIL    16  /* self calls in returns turned into jumps */
+#define OPT_ALL      31
+
+/* Function irNewInstr creates an unlinked instruction */
+IrInstr * irNewInstr( IrOp op, int d, int a, int b, int lineno );
+
+/* Procedures irInsertBefore and irRemove add an
+ * instruction to a block before instruction at
+ * (at the end if at is NULL) and take one out
+ */
+void irInsertBefore( IrBlock * blk, IrInstr * at, IrInstr * in );
+void irRemove( IrBlock * blk, IrInstr * in );
+
+/* Function irNewVreg adds a vreg to f */
+int irNewVreg( IrFunc * f, char * name );
+
+/* Procedure irFormat writes instruction in of f
+ * to buf as text (at most 120 characters)
+ */
+void irFormat( char * buf, IrFunc * f, IrInstr * in );
+
+/* Procedure irPrint prints the intermediate
+ * representation of the functions in f to the
+ * listing file
+ */
+void irPrint( IrFunc * f );
+
+#endif
@@ -0,0 +1,280 @@
+/****************************************************/
+/* File: kwgen.c                                    */
+/* Generates reserved.h, the minimal perfect hash   */
+/* for the reserved words of C-Minus                */
+/****************************************************/
+
+/* kwgen reads a list of reserved words, one word and
+ * its token name per line, and writes C code for a
+ * lookup in the style of gperf: the key of a word is
+ * its length plus an associated value for each of a
+ * few of its characters, and the values are searched
+ * for so the keys of the n words are n consecutive
+ * numbers; the key then indexes a table of the words
+ * and one compare decides
+ *
+ *   usage: kwgen reserved.txt > reserved.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+/* MAXWORDS = the largest number of words */
+#define MAXWORDS 64
+
+/* MAXWORDLEN = the longest word or token name */
+#define MAXWORDLEN 31
+
+/* MAXASSO = the largest associated value tried */
+#define MAXASSO 63
+
+/* key positions: a character of the word counted
+   from the front (1 is the first), or LASTPOS for
+   the last character */
+#define LASTPOS 0
+
+static struct
+    { char str[MAXWORDLEN+1];
+      char tok[MAXWORDLEN+1];
+      int len;
+    } words[MAXWORDS];
+static int nwords = 0;
+static int minlen, maxlen;
+
+/* the key positions tried, fewest first, and the
+   ones chosen */
+static int positionSets[][3] =
+   { {1,LASTPOS,-1}, {1,-1}, {LASTPOS,-1}, {2,-1}, {1,2,-1},
+     {2,LASTPOS,-1}, {1,2,LASTPOS} };
+#define NSETS (sizeof(positionSets) / sizeof(positionSets[0]))
+static int * positions;
+static int npositions;
+
+/* asso holds the associated values, -1 for a
+   character not given one yet */
+static int asso[256];
+
+/* chars lists the characters at the key positions,
+   in the order they are given values */
+static int chars[256];
+static int nchars;
+
+/* lastChar[w] is the index in chars of the last of
+   the key characters of word w to get a value */
+static int lastChar[MAXWORDS];
+
+static int minKey, maxKey;
+
+static int keyChar(int w, int i)
+{ int p = positions[i];
+  if (p == LASTPOS) return (unsigned char) words[w].str[words[w].len-1];
+  return (unsigned char) words[w].str[p-1];
+}
+
+static int key(int w)
+{ int k = words[w].len, i;
+  for (i = 0; i < npositions; i++) k += asso[keyChar(w,i)];
+  return k;
+}
+
+/* Function readWords reads the word list; returns
+   FALSE with a message if it is malformed */
+static int readWords(FILE * f)
+{ char line[256];
+  int w;
+  while (fgets(line,sizeof(line),f))
+  { char str[256], tok[256];
+    if (sscanf(line,"%255s %255s",str,tok) != 2) continue;
+    if (str[0] == '#') continue;
+    if ((nwords == MAXWORDS) || (strlen(str) > MAXWORDLEN)
+        || (strlen(tok) > MAXWORDLEN))
+    { fprintf(stderr,"kwgen: too many or too long words\n");
+      return FALSE;
+    }
+    strcpy(words[nwords].str,str);
+    strcpy(words[nwords].tok,tok);
+    words[nwords].len = strlen(str);
+    for (w = 0; w < nwords; w++)
+      if (strcmp(words[w].str,str) == 0)
+      { fprintf(stderr,"kwgen: %s listed twice\n",str);
+        return FALSE;
+      }
+    nwords++;
+  }
+  if (nwords == 0)
+  { fprintf(stderr,"kwgen: no words\n");
+    return FALSE;
+  }
+  minlen = maxlen = words[0].len;
+  for (w = 1; w < nwords; w++)
+  { if (words[w].len < minlen) minlen = words[w].len;
+    if (words[w].len > maxlen) maxlen = words[w].len;
+  }
+  return TRUE;
+}
+
+/* Function keysFit checks the keys of the words whose
+ * key characters all have values once chars[c] has
+ * one: they must differ and span fewer than nwords
+ * numbers, so a table of nwords entries holds them
+ */
+static int keysFit(int c)
+{ static int used[MAXWORDS * 2 + 1];
+  int w, lo = -1, hi = -1;
+  for (w = 0; w < nwords; w++)
+    if (lastChar[w] <= c)
+    { int k = key(w);
+      if ((lo < 0) || (k < lo)) lo = k;
+      if ((hi < 0) || (k > hi)) hi = k;
+    }
+  if (hi - lo >= nwords) return FALSE;
+  memset(used,0,sizeof(used));
+  for (w = 0; w < nwords; w++)
+    if (lastChar[w] <= c)
+    { int k = key(w) - lo;
+      if (used[k]) return FALSE;
+      used[k] = TRUE;
+    }
+  return TRUE;
+}
+
+/* Function search gives values to chars[c] and the
+   characters after it; returns TRUE on success */
+static int search(int c)
+{ int v;
+  if (c == nchars) return TRUE;
+  for (v = 0; v <= MAXASSO; v++)
+  { asso[chars[c]] = v;
+    if (keysFit(c) && search(c+1)) return TRUE;
+  }
+  asso[chars[c]] = -1;
+  return FALSE;
+}
+
+/* Function tryPositions looks for values with the
+   key positions in set s; returns TRUE on success */
+static int tryPositions(int s)
+{ int w, i, c;
+  positions = positionSets[s];
+  for (npositions = 0; (npositions < 3) && (positions[npositions] >= 0);
+       npositions++)
+    if ((positions[npositions] != LASTPOS)
+        && (positions[npositions] > minlen))
+      return FALSE;
+  for (c = 0; c < 256; c++) asso[c] = -1;
+  nchars = 0;
+  for (w = 0; w < nwords; w++)
+  { lastChar[w] = 0;
+    for (i = 0; i < npositions; i++)
+    { int ch = keyChar(w,i);
+      for (c = 0; (c < nchars) && (chars[c] != ch); c++) ;
+      if (c == nchars) chars[nchars++] = ch;
+      if (c > lastChar[w]) lastChar[w] = c;
+    }
+  }
+  if (!search(0)) return FALSE;
+  minKey = maxKey = key(0);
+  for (w = 1; w < nwords; w++)
+  { if (key(w) < minKey) minKey = key(w);
+    if (key(w) > maxKey) maxKey = key(w);
+  }
+  return TRUE;
+}
+
+static void positionName(int p, char * buf)
+{ if (p == LASTPOS) strcpy(buf,"s[len-1]");
+  else sprintf(buf,"s[%d]",p-1);
+}
+
+/* Procedure emit writes reserved.h */
+static void emit(char * listName)
+{ int c, w, k, i;
+  char buf[32];
+  printf("/****************************************************/\n");
+  printf("/* File: reserved.h                                 */\n");
+  printf("/* Generated by kwgen from %-24s */\n",listName);
+  printf("/* Do not edit                                      */\n");
+  printf("/****************************************************/\n\n");
+  printf("/* the minimal perfect hash of the %d reserved words:\n",nwords);
+  printf(" * key = len");
+  for (i = 0; i < npositions; i++)
+  { positionName(positions[i],buf);
+    printf(" + reservedAsso[%s]",buf);
+  }
+  printf("\n * is %d to %d, one for each of them; any other\n",
+         minKey,maxKey);
+  printf(" * identifier falls outside or fails the compare\n */\n\n");
+  printf("#define MIN_WORD_LENGTH %d\n",minlen);
+  printf("#define MAX_WORD_LENGTH %d\n",maxlen);
+  printf("#define MIN_HASH_VALUE %d\n",minKey);
+  printf("#define MAX_HASH_VALUE %d\n\n",maxKey);
+  /* a character at no key position of a word makes
+     the key too large for the table */
+  printf("static unsigned char reservedAsso[256] =\n   {");
+  for (c = 0; c < 256; c++)
+  { if (c % 16 == 0) printf("%s\n    ",c ? "," : "");
+    else printf(",");
+    printf("%2d",asso[c] >= 0 ? asso[c] : maxKey + 1);
+  }
+  printf("\n   };\n\n");
+  printf("static struct\n    { char * str;\n      int len;\n"
+         "      TokenType tok;\n    } reservedWords[%d]\n   = {",
+         maxKey - minKey + 1);
+  for (k = minKey; k <= maxKey; k++)
+  { for (w = 0; w < nwords; w++)
+      if (key(w) == k) break;
+    if ((k > minKey) && ((k - minKey) % 4 == 0)) printf(",\n      ");
+    else if (k > minKey) printf(",");
+    printf("{\"%s\",%d,%s}",words[w].str,words[w].len,words[w].tok);
+  }
+  printf("};\n\n");
+  printf("/* lookup an identifier to see if it is a reserved word */\n");
+  printf("static TokenType reservedLookup (char * s, int len)\n");
+  printf("{ unsigned key;\n");
+  printf("  if ((len < MIN_WORD_LENGTH) || (len > MAX_WORD_LENGTH))"
+         " return ID;\n");
+  printf("  key = len - MIN_HASH_VALUE");
+  for (i = 0; i < npositions; i++)
+  { positionName(positions[i],buf);
+    printf("\n        + reservedAsso[(unsigned char) %s]",buf);
+  }
+  printf(";\n");
+  printf("  if ((key <= MAX_HASH_VALUE - MIN_HASH_VALUE) &&\n");
+  printf("      (reservedWords[key].len == len) &&\n");
+  printf("      (memcmp(s,reservedWords[key].str,len) == 0))\n");
+  printf("    return reservedWords[key].tok;\n");
+  printf("  return ID;\n");
+  printf("}\n");
+}
+
+int main(int argc, char * argv[])
+{ FILE * f;
+  int s;
+  if (argc != 2)
+  { fprintf(stderr,"usage: %s <word list>\n",argv[0]);
+    exit(1);
+  }
+  f = fopen(argv[1],"r");
+  if (f == NULL)
+  { fprintf(stderr,"kwgen: %s not found\n",argv[1]);
+    exit(1);
+  }
+  if (!readWords(f)) exit(1);
+  fclose(f);
+  for (s = 0; s < (int) NSETS; s++)
+    if (tryPositions(s))
+    { emit(argv[1]);
+      return 0;
+    }
+  fprintf(stderr,"kwgen: no minimal perfect hash found\n");
+  exit(1);
+}
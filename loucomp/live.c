@@ -0,0 +1,201 @@
+/****************************************************/
+/* File: live.c                                     */
+/* Liveness analysis and dead code elimination on   */
+/* the intermediate representation                  */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "live.h"
+
+static void liveOutOfMemory( void )
+{ fprintf(listing,"Out of memory error in liveness analysis\n");
+  exit(1);
+}
+
+static void * liveAlloc( int n, int size )
+{ void * p = calloc(n > 0 ? n : 1,size);
+  if (p == NULL) liveOutOfMemory();
+  return p;
+}
+
+/**************************************************/
+/***********   Liveness                ************/
+/**************************************************/
+
+/* Procedure irLiveness computes the live vregs at
+ * the block boundaries of f by iterating the data
+ * flow equations  out(b) = union of in(s) over the
+ * successors s, in(b) = use(b) + (out(b) - def(b))
+ * until nothing changes
+ */
+void irLiveness( IrFunc * f )
+{ IrBlock * b, ** order;
+  IrInstr * in;
+  char ** use, ** def, * s1, * s2;
+  int nv = f->nvregs, nb = 0, i, v, changed;
+  for (b = f->entry; b != NULL; b = b->next)
+  { free(b->liveIn);
+    free(b->liveOut);
+    b->liveIn = (char *) liveAlloc(nv,1);
+    b->liveOut = (char *) liveAlloc(nv,1);
+    nb++;
+  }
+  /* the blocks are visited backwards, which is the
+     quicker order for a backward problem */
+  order = (IrBlock **) liveAlloc(nb,sizeof(IrBlock *));
+  use = (char **) liveAlloc(nb,sizeof(char *));
+  def = (char **) liveAlloc(nb,sizeof(char *));
+  i = nb;
+  for (b = f->entry; b != NULL; b = b->next)
+  { order[--i] = b;
+    use[i] = (char *) liveAlloc(nv,1);
+    def[i] = (char *) liveAlloc(nv,1);
+    /* the vregs used before any definition in b */
+    for (in = b->first; in != NULL; in = in->next)
+    { if ((in->a != NO_VREG) && !def[i][in->a]) use[i][in->a] = TRUE;
+      if ((in->b != NO_VREG) && !def[i][in->b]) use[i][in->b] = TRUE;
+      if (in->d != NO_VREG) def[i][in->d] = TRUE;
+    }
+  }
+  do
+  { changed = FALSE;
+    for (i = 0; i < nb; i++)
+    { b = order[i];
+      s1 = (b->last->t1 == NULL) ? NULL : b->last->t1->liveIn;
+      s2 = (b->last->t2 == NULL) ? NULL : b->last->t2->liveIn;
+      for (v = 0; v < nv; v++)
+      { if ((s1 != NULL) && s1[v]) b->liveOut[v] = TRUE;
+        if ((s2 != NULL) && s2[v]) b->liveOut[v] = TRUE;
+        if (!b->liveIn[v] && (use[i][v] || (b->liveOut[v] && !def[i][v])))
+        { b->liveIn[v] = TRUE;
+          changed = TRUE;
+        }
+      }
+    }
+  } while (changed);
+  for (i = 0; i < nb; i++)
+  { free(use[i]);
+    free(def[i]);
+  }
+  free(use);
+  free(def);
+  free(order);
+}
+
+/**************************************************/
+/***********   Dead code elimination   ************/
+/**************************************************/
+
+/* for each vreg, the value of its definition if it
+   has exactly one and that is a constant */
+static int * defCount;
+static int * constValue;
+
+/* Function canRemove tells whether in has no effect
+ * but setting its result: it cannot stop the TM (by
+ * a division by zero or a memory reference out of
+ * range) and reads no input
+ */
+static int canRemove( IrInstr * in )
+{ switch (in->op) {
+    case IR_CONST :
+    case IR_COPY :
+    case IR_ADD :
+    case IR_SUB :
+    case IR_MUL :
+    case IR_CMP :
+    case IR_ADDR :
+    case IR_GLOAD :
+      return TRUE;
+    case IR_DIV :
+      return (defCount[in->b] == 1) && (constValue[in->b] != 0);
+    default :
+      return FALSE;
+  }
+}
+
+/* Procedure deadStores removes the stores to global
+ * variables in b that are overwritten later in b
+ * with no load or call in between
+ */
+static void deadStores( IrBlock * b, DceStats * stats )
+{ IrInstr * in, * prev;
+  TreeNode ** stored;
+  int n = 0, i;
+  for (in = b->first; in != NULL; in = in->next) n++;
+  stored = (TreeNode **) liveAlloc(n,sizeof(TreeNode *));
+  n = 0;
+  for (in = b->last; in != NULL; in = prev)
+  { prev = in->prev;
+    switch (in->op) {
+      case IR_GSTORE :
+        for (i = 0; (i < n) && (stored[i] != in->var); i++) ;
+        if (i < n)
+        { irRemove(b,in);
+          free(in);
+          stats->stores++;
+        }
+        else stored[n++] = in->var;
+        break;
+      case IR_GLOAD :
+        for (i = 0; i < n; i++)
+          if (stored[i] == in->var) stored[i] = stored[--n];
+        break;
+      case IR_CALL :
+        n = 0;
+        break;
+      default :
+        break;
+    }
+  }
+  free(stored);
+}
+
+/* Procedure deadCode removes the dead instructions
+ * of f, until no more become dead
+ */
+void deadCode( IrFunc * f, DceStats * stats )
+{ IrBlock * b;
+  IrInstr * in, * prev;
+  char * live;
+  int nv = f->nvregs, removed;
+  defCount = (int *) liveAlloc(nv,sizeof(int));
+  constValue = (int *) liveAlloc(nv,sizeof(int));
+  live = (char *) liveAlloc(nv,1);
+  for (b = f->entry; b != NULL; b = b->next)
+  { deadStores(b,stats);
+    for (in = b->first; in != NULL; in = in->next)
+      if (in->d != NO_VREG)
+      { defCount[in->d]++;
+        constValue[in->d] = (in->op == IR_CONST) ? in->imm : 0;
+      }
+  }
+  do
+  { irLiveness(f);
+    removed = 0;
+    for (b = f->entry; b != NULL; b = b->next)
+    { memcpy(live,b->liveOut,nv);
+      for (in = b->last; in != NULL; in = prev)
+      { prev = in->prev;
+        if ((in->d != NO_VREG) && !live[in->d])
+        { if (canRemove(in))
+          { irRemove(b,in);
+            free(in);
+            removed++;
+            continue;
+          }
+          /* a call is kept for its effects */
+          if (in->op == IR_CALL) in->d = NO_VREG;
+        }
+        if (in->d != NO_VREG) live[in->d] = FALSE;
+        if (in->a != NO_VREG) live[in->a] = TRUE;
+        if (in->b != NO_VREG) live[in->b] = TRUE;
+      }
+    }
+    stats->instrs += removed;
+  } while (removed > 0);
+  free(defCount);
+  free(constValue);
+  free(live);
+}
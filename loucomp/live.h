@@ -0,0 +1,33 @@
+/****************************************************/
+/* File: live.h                                     */
+/* Liveness analysis and dead code elimination on   */
+/* the intermediate representation                  */
+/****************************************************/
+
+#ifndef _LIVE_H_
+#define _LIVE_H_
+
+#include "ir.h"
+
+/* Procedure irLiveness computes the vregs live at
+ * the start (liveIn) and at the end (liveOut) of
+ * each block of f, which must not be in SSA form
+ */
+void irLiveness( IrFunc * f );
+
+/* counts for the TraceOpt report */
+typedef struct
+   { int instrs;    /* instructions removed */
+     int stores;    /* stores to global variables removed */
+   } DceStats;
+
+/* Procedure deadCode removes the instructions of f
+ * whose result is never used and that have no
+ * other effect, and the stores to global variables
+ * that are overwritten in the same block before
+ * anything can read them. The counts are added to
+ * stats.
+ */
+void deadCode( IrFunc * f, DceStats * stats );
+
+#endif
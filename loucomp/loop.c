@@ -0,0 +1,468 @@
+/****************************************************/
+/* File: loop.c                                     */
+/* Loop optimization on the intermediate            */
+/* representation for the C-Minus compiler          */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+#include "live.h"
+#include "loop.h"
+
+static void loopOutOfMemory( void )
+{ fprintf(listing,"Out of memory error in loop optimization\n");
+  exit(1);
+}
+
+static void * loopAlloc( int n, int size )
+{ void * p = calloc(n > 0 ? n : 1,size);
+  if (p == NULL) loopOutOfMemory();
+  return p;
+}
+
+/* the number of definitions and uses of each vreg
+   of the function, and whether its only definition
+   is a constant */
+static int * defCount;
+static int * useCount;
+static char * isConst;
+static int * constValue;
+static int ncounted;     /* the vregs added later are not counted */
+
+/* Procedure countVregs fills the tables above */
+static void countVregs( IrFunc * f )
+{ IrBlock * b;
+  IrInstr * in;
+  int nv = f->nvregs, v;
+  ncounted = nv;
+  defCount = (int *) loopAlloc(nv,sizeof(int));
+  useCount = (int *) loopAlloc(nv,sizeof(int));
+  isConst = (char *) loopAlloc(nv,1);
+  constValue = (int *) loopAlloc(nv,sizeof(int));
+  for (b = f->entry; b != NULL; b = b->next)
+    for (in = b->first; in != NULL; in = in->next)
+    { if (in->d != NO_VREG)
+      { defCount[in->d]++;
+        isConst[in->d] = in->op == IR_CONST;
+        constValue[in->d] = in->imm;
+      }
+      if (in->a != NO_VREG) useCount[in->a]++;
+      if (in->b != NO_VREG) useCount[in->b]++;
+    }
+  for (v = 0; v < nv; v++)
+    if (defCount[v] != 1) isConst[v] = FALSE;
+}
+
+static void freeCounts( void )
+{ free(defCount);
+  free(useCount);
+  free(isConst);
+  free(constValue);
+}
+
+/**************************************************/
+/***********   Repeated computations   ************/
+/**************************************************/
+
+/* a computation whose result is still held by d */
+typedef struct
+   { IrOp op;
+     int a, b;
+     TreeNode * var;
+     int imm;
+     int d;
+   } AVAIL;
+
+/* Function sameOperand tells whether vregs x and y
+ * hold the same value: they are the same vreg or
+ * both hold the same constant
+ */
+static int sameOperand( int x, int y )
+{ if (x == y) return TRUE;
+  return (x != NO_VREG) && (y != NO_VREG) && isConst[x] && isConst[y]
+         && (constValue[x] == constValue[y]);
+}
+
+/* Function sameComputation tells whether in
+ * computes what e does
+ */
+static int sameComputation( AVAIL * e, IrInstr * in )
+{ if ((e->op != in->op) || (e->var != in->var)) return FALSE;
+  if (in->op == IR_ADDR) return e->imm == in->imm;
+  if (sameOperand(e->a,in->a) && sameOperand(e->b,in->b)) return TRUE;
+  /* + and * commute */
+  return ((in->op == IR_ADD) || (in->op == IR_MUL))
+         && sameOperand(e->a,in->b) && sameOperand(e->b,in->a);
+}
+
+/* Procedure reuseBlock replaces the additions,
+ * subtractions, multiplications and array addresses
+ * of block b computed before in b (with the same
+ * operands still holding the same values) by the
+ * earlier result
+ */
+static void reuseBlock( IrBlock * b, LoopStats * stats )
+{ IrInstr * in, * next, * u;
+  AVAIL * avail;
+  int n = 0, i, e, uses;
+  for (in = b->first; in != NULL; in = in->next) n++;
+  avail = (AVAIL *) loopAlloc(n,sizeof(AVAIL));
+  n = 0;
+  for (in = b->first; in != NULL; in = next)
+  { next = in->next;
+    if ((in->op == IR_ADD) || (in->op == IR_SUB) || (in->op == IR_MUL)
+        || (in->op == IR_ADDR))
+    { for (i = 0; (i < n) && !sameComputation(&avail[i],in); i++)
+        ;
+      if (i < n)
+      { e = avail[i].d;
+        stats->reused++;
+        if (in->a != NO_VREG) useCount[in->a]--;
+        if (in->b != NO_VREG) useCount[in->b]--;
+        /* the uses of a temporary used only later in this
+           block take the earlier result instead */
+        uses = 0;
+        for (u = next; u != NULL; u = u->next)
+          uses += (u->a == in->d) + (u->b == in->d);
+        if ((defCount[e] == 1) && (defCount[in->d] == 1)
+            && (uses == useCount[in->d]))
+        { for (u = next; u != NULL; u = u->next)
+          { if (u->a == in->d) u->a = e;
+            if (u->b == in->d) u->b = e;
+          }
+          useCount[e] += uses;
+          defCount[in->d] = 0;
+          irRemove(b,in);
+          free(in);
+          continue;
+        }
+        in->op = IR_COPY;
+        in->a = e;
+        in->b = NO_VREG;
+        in->var = NULL;
+        useCount[e]++;
+      }
+    }
+    if (in->d == NO_VREG) continue;
+    /* forget what depended on the old value of d */
+    for (i = 0; i < n; )
+      if ((avail[i].a == in->d) || (avail[i].b == in->d)
+          || (avail[i].d == in->d))
+        avail[i] = avail[--n];
+      else i++;
+    if (((in->op == IR_ADD) || (in->op == IR_SUB) || (in->op == IR_MUL)
+         || (in->op == IR_ADDR))
+        && (in->d != in->a) && (in->d != in->b))
+    { avail[n].op = in->op;
+      avail[n].a = in->a;
+      avail[n].b = in->b;
+      avail[n].var = in->var;
+      avail[n].imm = in->imm;
+      avail[n].d = in->d;
+      n++;
+    }
+  }
+  free(avail);
+}
+
+/**************************************************/
+/***********   Loop invariant code     ************/
+/**************************************************/
+
+/* a loop: its header, which dominates the loop, and
+   the labels of its blocks */
+typedef struct
+   { IrBlock * header;
+     char * body;
+     int size;
+   } LOOP;
+
+static LOOP * loops;
+static int nloops;
+
+/* Procedure findLoops finds the natural loops of f:
+ * an edge to a block that dominates its source closes
+ * a loop. The loops are sorted from the smallest, so
+ * that an inner loop comes before the loops around it.
+ */
+static void findLoops( IrFunc * f )
+{ IrBlock * b, * h, * x, ** work;
+  LOOP * l, t;
+  int nb = 0, nwork, i, j, k;
+  for (b = f->entry; b != NULL; b = b->next) nb++;
+  irDominators(f);
+  loops = (LOOP *) loopAlloc(nb,sizeof(LOOP));
+  work = (IrBlock **) loopAlloc(nb,sizeof(IrBlock *));
+  nloops = 0;
+  for (b = f->entry; b != NULL; b = b->next)
+    for (k = 0; k < 2; k++)
+    { h = (k == 0) ? b->last->t1 : b->last->t2;
+      if ((h == NULL) || ((k == 1) && (h == b->last->t1))
+          || !irDominates(h,b))
+        continue;
+      for (i = 0; (i < nloops) && (loops[i].header != h); i++) ;
+      l = &loops[i];
+      if (i == nloops)
+      { nloops++;
+        l->header = h;
+        /* room for the blocks added before the loops */
+        l->body = (char *) loopAlloc(f->nlabels + nb,1);
+        l->body[h->label] = TRUE;
+        l->size = 1;
+      }
+      /* the blocks that reach b without passing h */
+      nwork = 0;
+      if (!l->body[b->label])
+      { l->body[b->label] = TRUE;
+        l->size++;
+        work[nwork++] = b;
+      }
+      while (nwork > 0)
+      { x = work[--nwork];
+        for (j = 0; j < x->npred; j++)
+          if (!l->body[x->pred[j]->label])
+          { l->body[x->pred[j]->label] = TRUE;
+            l->size++;
+            work[nwork++] = x->pred[j];
+          }
+      }
+    }
+  free(work);
+  for (i = 1; i < nloops; i++)
+    for (j = i; (j > 0) && (loops[j - 1].size > loops[j].size); j--)
+    { t = loops[j];
+      loops[j] = loops[j - 1];
+      loops[j - 1] = t;
+    }
+}
+
+/* Function preheader returns the block that control
+ * passes through just before entering loop l: the
+ * block before the loop if it jumps to the header,
+ * or a new block that the edges into the loop are
+ * moved to
+ */
+static IrBlock * preheader( IrFunc * f, LOOP * l )
+{ IrBlock * h = l->header, * b, * p = NULL;
+  IrInstr * t;
+  int k, n = 0;
+  for (k = 0; k < h->npred; k++)
+    if (!l->body[h->pred[k]->label])
+    { p = h->pred[k];
+      n++;
+    }
+  if ((n == 1) && (p->last->op == IR_JUMP)) return p;
+  b = (IrBlock *) loopAlloc(1,sizeof(IrBlock));
+  b->label = f->nlabels++;
+  t = irNewInstr(IR_JUMP,NO_VREG,NO_VREG,NO_VREG,h->first->lineno);
+  t->t1 = h;
+  irInsertBefore(b,NULL,t);
+  for (k = 0; k < h->npred; k++)
+    if (!l->body[h->pred[k]->label])
+    { t = h->pred[k]->last;
+      if (t->t1 == h) t->t1 = b;
+      if (t->t2 == h) t->t2 = b;
+    }
+  /* laid out last: it runs once for each entry
+     into the loop */
+  for (p = f->entry; p->next != NULL; p = p->next) ;
+  p->next = b;
+  irLinkBlocks(f);
+  /* the loops around l contain the new block */
+  for (k = 0; k < nloops; k++)
+    if ((&loops[k] != l) && loops[k].body[h->label])
+      loops[k].body[b->label] = TRUE;
+  return b;
+}
+
+/* the instructions of the loop being optimized and
+   their blocks, the definitions in the loop of each
+   vreg, the invariant definition of each vreg (or
+   NULL), the vregs whose definition was moved, and
+   the copies of the cheap invariants before the loop */
+static IrInstr ** ins;
+static IrBlock ** insBlock;
+static int nins;
+static int * loopDefs;
+static IrInstr ** invDef;
+static char * moved;
+static int * copyOf;
+
+/* Function isCheap tells whether in costs no more
+ * than loading its result from memory, so that it
+ * is better done again than kept in the frame
+ */
+static int isCheap( IrInstr * in )
+{ return (in->op == IR_CONST) || (in->op == IR_ADDR)
+         || (in->op == IR_GLOAD) || (in->op == IR_COPY);
+}
+
+/* Function isInvariant tells whether in computes the
+ * same value in every iteration of loop l
+ */
+static int isInvariant( IrInstr * in, LOOP * l, int hasCall )
+{ int i;
+  if ((in->d == NO_VREG) || (loopDefs[in->d] != 1)
+      || l->header->liveIn[in->d])
+    return FALSE;
+  switch (in->op) {
+    case IR_CONST :
+    case IR_ADDR :
+    case IR_COPY :
+    case IR_ADD :
+    case IR_SUB :
+    case IR_MUL :
+    case IR_CMP :
+      break;
+    case IR_DIV :
+      /* it must not divide by zero */
+      if (invDef[in->b] != NULL)
+      { if ((invDef[in->b]->op != IR_CONST) || (invDef[in->b]->imm == 0))
+          return FALSE;
+      }
+      else if ((in->b >= ncounted) || !isConst[in->b]
+               || (constValue[in->b] == 0))
+        return FALSE;
+      break;
+    case IR_GLOAD :
+      /* the variable must not be changed in the loop */
+      if (hasCall) return FALSE;
+      for (i = 0; i < nins; i++)
+        if ((ins[i]->op == IR_GSTORE) && (ins[i]->var == in->var))
+          return FALSE;
+      break;
+    default :
+      return FALSE;
+  }
+  if ((in->a != NO_VREG) && (loopDefs[in->a] > 0) && (invDef[in->a] == NULL))
+    return FALSE;
+  if ((in->b != NO_VREG) && (loopDefs[in->b] > 0) && (invDef[in->b] == NULL))
+    return FALSE;
+  return TRUE;
+}
+
+/* Function liveAtExit tells whether vreg v is live
+ * when loop l is left
+ */
+static int liveAtExit( IrFunc * f, LOOP * l, int v )
+{ IrBlock * b, * s;
+  int k;
+  for (b = f->entry; b != NULL; b = b->next)
+  { if (!l->body[b->label]) continue;
+    for (k = 0; k < 2; k++)
+    { s = (k == 0) ? b->last->t1 : b->last->t2;
+      if ((s != NULL) && !l->body[s->label] && s->liveIn[v]) return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* Function ready tells whether the value of operand
+ * v can be had before the loop
+ */
+static int ready( int v )
+{ return (v == NO_VREG) || (loopDefs[v] == 0) || moved[v]
+         || ((invDef[v] != NULL) && isCheap(invDef[v]));
+}
+
+/* Function copyBefore returns a vreg set to the value
+ * of operand v in block pre, copying its cheap
+ * invariant definition there if it is in the loop
+ */
+static int copyBefore( IrFunc * f, IrBlock * pre, int v )
+{ IrInstr * in, * c;
+  if ((v == NO_VREG) || (loopDefs[v] == 0) || moved[v]) return v;
+  if (copyOf[v] != NO_VREG) return copyOf[v];
+  in = invDef[v];
+  c = irNewInstr(in->op,irNewVreg(f,NULL),copyBefore(f,pre,in->a),
+                 NO_VREG,in->lineno);
+  c->imm = in->imm;
+  c->var = in->var;
+  irInsertBefore(pre,pre->last,c);
+  copyOf[v] = c->d;
+  return c->d;
+}
+
+/* Procedure hoist moves the invariant computations of
+ * loop l that cost more than a load before the loop.
+ * The cheap invariants they use are copied, and stay
+ * in the loop for the other uses.
+ */
+static void hoist( IrFunc * f, LOOP * l, LoopStats * stats )
+{ IrBlock * b, * pre = NULL;
+  IrInstr * in;
+  int nv = f->nvregs, i, v, hasCall = FALSE, changed;
+  irLiveness(f);
+  nins = 0;
+  for (b = f->entry; b != NULL; b = b->next)
+    if (l->body[b->label])
+      for (in = b->first; in != NULL; in = in->next) nins++;
+  ins = (IrInstr **) loopAlloc(nins,sizeof(IrInstr *));
+  insBlock = (IrBlock **) loopAlloc(nins,sizeof(IrBlock *));
+  loopDefs = (int *) loopAlloc(nv,sizeof(int));
+  invDef = (IrInstr **) loopAlloc(nv,sizeof(IrInstr *));
+  moved = (char *) loopAlloc(nv,1);
+  copyOf = (int *) loopAlloc(nv,sizeof(int));
+  for (v = 0; v < nv; v++) copyOf[v] = NO_VREG;
+  nins = 0;
+  for (b = f->entry; b != NULL; b = b->next)
+    if (l->body[b->label])
+      for (in = b->first; in != NULL; in = in->next)
+      { ins[nins] = in;
+        insBlock[nins++] = b;
+        if (in->d != NO_VREG) loopDefs[in->d]++;
+        if (in->op == IR_CALL) hasCall = TRUE;
+      }
+  /* the invariants, until no more are found */
+  do
+  { changed = FALSE;
+    for (i = 0; i < nins; i++)
+    { in = ins[i];
+      if ((in->d != NO_VREG) && (invDef[in->d] != in)
+          && isInvariant(in,l,hasCall))
+      { invDef[in->d] = in;
+        changed = TRUE;
+      }
+    }
+  } while (changed);
+  /* move the costly ones whose operands are ready */
+  do
+  { changed = FALSE;
+    for (i = 0; i < nins; i++)
+    { in = ins[i];
+      if ((in->d == NO_VREG) || (invDef[in->d] != in) || moved[in->d]
+          || isCheap(in) || !ready(in->a) || !ready(in->b)
+          || liveAtExit(f,l,in->d))
+        continue;
+      if (pre == NULL) pre = preheader(f,l);
+      in->a = copyBefore(f,pre,in->a);
+      in->b = copyBefore(f,pre,in->b);
+      irRemove(insBlock[i],in);
+      irInsertBefore(pre,pre->last,in);
+      moved[in->d] = TRUE;
+      stats->hoisted++;
+      changed = TRUE;
+    }
+  } while (changed);
+  free(ins);
+  free(insBlock);
+  free(loopDefs);
+  free(invDef);
+  free(moved);
+  free(copyOf);
+}
+
+/* Procedure loopOpt optimizes the loops of f */
+void loopOpt( IrFunc * f, LoopStats * stats )
+{ IrBlock * b;
+  int i;
+  countVregs(f);
+  for (b = f->entry; b != NULL; b = b->next) reuseBlock(b,stats);
+  findLoops(f);
+  stats->loops += nloops;
+  for (i = 0; i < nloops; i++) hoist(f,&loops[i],stats);
+  for (i = 0; i < nloops; i++) free(loops[i].body);
+  free(loops);
+  freeCounts();
+}
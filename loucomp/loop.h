@@ -0,0 +1,29 @@
+/****************************************************/
+/* File: loop.h                                     */
+/* Loop optimization on the intermediate            */
+/* representation for the C-Minus compiler          */
+/****************************************************/
+
+#ifndef _LOOP_H_
+#define _LOOP_H_
+
+#include "ir.h"
+
+/* counts for the TraceOpt report */
+typedef struct
+   { int loops;     /* loops found */
+     int hoisted;   /* computations moved out of loops */
+     int reused;    /* computations replaced by an earlier result */
+   } LoopStats;
+
+/* Procedure loopOpt moves the computations of f
+ * that give the same result in every iteration of
+ * a loop out of the loop, into a block executed
+ * once before it, and reuses the result of a
+ * computation (such as the address of an array
+ * element) repeated in a block. f must not be in
+ * SSA form. The counts are added to stats.
+ */
+void loopOpt( IrFunc * f, LoopStats * stats );
+
+#endif
@@ -0,0 +1,530 @@
+/****************************************************/
+/* File: lower.c                                    */
+/* Lowering of the intermediate representation to   */
+/* TM code for the C-Minus compiler                 */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+#include "ir.h"
+#include "live.h"
+#include "lower.h"
+
+/* The activation record is the one codeGen builds
+ * (see cgen.c): old fp, return address, then the
+ * parameters and the local arrays (frameSize
+ * locations), then the locations the vregs are kept
+ * in when they are not in a register.
+ */
+#define ofpFO 0
+#define retFO -1
+#define initFO -2
+
+/* Registers ac (0) up to NO_TEMP_REGS-1 hold vregs */
+#define NO_TEMP_REGS 4
+
+/* Vregs are assigned to registers block by block.
+ * A vreg used in a single block and set there before
+ * any use (a "local" vreg, which is what most temps
+ * are) is kept in a register from its definition to
+ * its last use, and stored to the frame only if the
+ * registers run out or a call intervenes. Any other
+ * vreg has a home location in the frame: it is
+ * loaded when first used in a block, kept in its
+ * register while the block runs, and stored back
+ * (if it was changed and is live) at the end of the
+ * block.
+ */
+static IrFunc * curFunc;
+static IrBlock * curBlock;
+static int * slot;       /* frame location of each vreg, 0 if none */
+static int * inReg;      /* register holding each vreg, -1 if none */
+static char * isLocal;   /* local vregs, see above */
+static int * lastUse;    /* index of the last use of a vreg in the
+                            block, -1 if its value is not used */
+static int regVreg[NO_TEMP_REGS];  /* vreg in each register, or -1 */
+static int regDirty[NO_TEMP_REGS]; /* changed since loaded */
+static int nextSlot;     /* next free frame location */
+static int pos;          /* index of the instruction being lowered */
+
+/* Backpatching: jumps to blocks whose location is not
+ * known yet, and the instructions of the call sequence
+ * that depend on the size of the frame (known at the
+ * end of the function)
+ */
+typedef struct
+   { int loc;
+     char * op;
+     int r, d;
+     IrBlock * target;   /* NULL: d is relative to the frame end */
+   } FIXUP;
+
+static FIXUP * fixups = NULL;
+static int nfixups = 0, maxfixups = 0;
+
+static void lowerOutOfMemory( void )
+{ fprintf(listing,"Out of memory error in IR lowering\n");
+  exit(1);
+}
+
+/* Procedure addFixup reserves a location for an
+ * instruction to be patched at the end of the function
+ */
+static void addFixup( char * op, int r, int d, IrBlock * target )
+{ if (nfixups == maxfixups)
+  { maxfixups = maxfixups == 0 ? 64 : 2 * maxfixups;
+    fixups = (FIXUP *) realloc(fixups,maxfixups * sizeof(FIXUP));
+    if (fixups == NULL) lowerOutOfMemory();
+  }
+  fixups[nfixups].loc = emitSkip(1);
+  fixups[nfixups].op = op;
+  fixups[nfixups].r = r;
+  fixups[nfixups].d = d;
+  fixups[nfixups].target = target;
+  nfixups++;
+}
+
+/* Function homeOf returns the frame location of v,
+ * allocating one if it has none
+ */
+static int homeOf( int v )
+{ if (slot[v] == 0) slot[v] = nextSlot--;
+  return slot[v];
+}
+
+/* Procedure writeBack stores register r to the
+ * home of its vreg if it was changed
+ */
+static void writeBack( int r )
+{ int v = regVreg[r];
+  if ((v >= 0) && regDirty[r])
+  { emitRM("ST",r,homeOf(v),fp,"store vreg");
+    regDirty[r] = FALSE;
+  }
+}
+
+/* Procedure release forgets the contents of r */
+static void release( int r )
+{ if (regVreg[r] >= 0) inReg[regVreg[r]] = -1;
+  regVreg[r] = -1;
+  regDirty[r] = FALSE;
+}
+
+/* Function isLive tells whether vreg v is used
+ * after the current instruction
+ */
+static int isLive( int v )
+{ return (lastUse[v] > pos) || (!isLocal[v] && curBlock->liveOut[v]);
+}
+
+/* Function getReg returns a free register that is
+ * not in the mask avoid, freeing one if necessary
+ */
+static int getReg( int avoid )
+{ int r, best = -1;
+  for (r = 0; r < NO_TEMP_REGS; r++)
+    if (!(avoid & (1 << r)) && (regVreg[r] < 0)) return r;
+  /* prefer a register that need not be stored */
+  for (r = 0; r < NO_TEMP_REGS; r++)
+    if (!(avoid & (1 << r)))
+    { if (!regDirty[r]) { best = r; break; }
+      if (best < 0) best = r;
+    }
+  writeBack(best);
+  release(best);
+  return best;
+}
+
+/* Function use returns the register holding vreg v,
+ * loading it if necessary
+ */
+static int use( int v, int avoid )
+{ int r;
+  if (inReg[v] >= 0) return inReg[v];
+  r = getReg(avoid);
+  emitRM("LD",r,homeOf(v),fp,"load vreg");
+  regVreg[r] = v;
+  inReg[v] = r;
+  return r;
+}
+
+/* Procedure done frees the register of vreg v if
+ * the current instruction is its last use
+ */
+static void done( int v )
+{ if ((v != NO_VREG) && (inReg[v] >= 0) && !isLive(v))
+    release(inReg[v]);
+}
+
+/* Function def returns the register to compute
+ * vreg v into, which is marked as changed
+ */
+static int def( int v, int avoid )
+{ int r = inReg[v];
+  if (r < 0)
+  { r = getReg(avoid);
+    regVreg[r] = v;
+    inReg[v] = r;
+  }
+  regDirty[r] = TRUE;
+  return r;
+}
+
+/* Procedure defDone frees the register of a vreg
+ * just set if its value is never used (a copy of
+ * a vreg to itself may have freed it already)
+ */
+static void defDone( int v )
+{ if ((inReg[v] >= 0) && !isLive(v)) release(inReg[v]);
+}
+
+/* Procedure flush stores the changed registers
+ * holding vregs used after the current instruction
+ * and forgets all registers
+ */
+static void flush( void )
+{ int r;
+  for (r = 0; r < NO_TEMP_REGS; r++)
+  { if ((regVreg[r] >= 0) && isLive(regVreg[r])) writeBack(r);
+    release(r);
+  }
+}
+
+/* Procedure writeBackAll stores the changed vregs
+ * that are live after the block
+ */
+static void writeBackAll( void )
+{ int r;
+  for (r = 0; r < NO_TEMP_REGS; r++)
+    if ((regVreg[r] >= 0) && curBlock->liveOut[regVreg[r]]) writeBack(r);
+}
+
+/* Function jumpOp returns the conditional jump
+ * taken when rel holds of a register against 0
+ */
+static char * jumpOp( TokenType rel, int inverse )
+{ switch (rel) {
+    case LT : return inverse ? "JGE" : "JLT";
+    case LE : return inverse ? "JGT" : "JLE";
+    case GT : return inverse ? "JLE" : "JGT";
+    case GE : return inverse ? "JLT" : "JGE";
+    case EQ : return inverse ? "JNE" : "JEQ";
+    default : return inverse ? "JEQ" : "JNE";
+  }
+}
+
+/* Procedure classify finds the local vregs of f and
+ * the last use of each in its block
+ */
+static void classify( IrFunc * f )
+{ IrBlock * b;
+  IrInstr * in;
+  IrBlock ** blockOf;
+  int v, k, i, u[2];
+  blockOf = (IrBlock **) calloc(f->nvregs,sizeof(IrBlock *));
+  if (blockOf == NULL) lowerOutOfMemory();
+  for (v = 0; v < f->nvregs; v++)
+  { isLocal[v] = v >= f->nparams;
+    lastUse[v] = -1;
+  }
+  for (b = f->entry; b != NULL; b = b->next)
+    for (in = b->first, k = 0; in != NULL; in = in->next, k++)
+    { u[0] = in->a;
+      u[1] = in->b;
+      for (i = 0; i < 2; i++)
+        if ((v = u[i]) != NO_VREG)
+        { if (blockOf[v] != b) isLocal[v] = FALSE;
+          lastUse[v] = k;
+        }
+      if ((v = in->d) != NO_VREG)
+      { if ((blockOf[v] != NULL) && (blockOf[v] != b)) isLocal[v] = FALSE;
+        blockOf[v] = b;
+      }
+    }
+  free(blockOf);
+}
+
+/* Procedure lowerInstr generates code for in, the
+ * instruction at index pos of its block; next is
+ * the block laid out after that block
+ */
+static void lowerInstr( IrInstr * in, IrBlock * next )
+{ int ra, rb, rd;
+  switch (in->op) {
+
+    case IR_CONST :
+      rd = def(in->d,0);
+      emitRM("LDC",rd,in->imm,0,"load const");
+      defDone(in->d);
+      break;
+
+    case IR_COPY :
+      ra = use(in->a,0);
+      if (!isLive(in->a) && (inReg[in->d] < 0))
+      { /* the register changes hands */
+        release(ra);
+        regVreg[ra] = in->d;
+        inReg[in->d] = ra;
+        regDirty[ra] = TRUE;
+      }
+      else
+      { rd = def(in->d,1 << ra);
+        emitRM("LDA",rd,0,ra,"copy");
+        done(in->a);
+      }
+      defDone(in->d);
+      break;
+
+    case IR_ADD :
+    case IR_SUB :
+    case IR_MUL :
+    case IR_DIV :
+    case IR_CMP :
+      ra = use(in->a,0);
+      rb = use(in->b,1 << ra);
+      done(in->a);
+      done(in->b);
+      /* the result may reuse the register of an operand
+         used for the last time */
+      rd = def(in->d,(inReg[in->a] >= 0 ? 1 << ra : 0)
+                     | (inReg[in->b] >= 0 ? 1 << rb : 0));
+      switch (in->op) {
+        case IR_ADD : emitRO("ADD",rd,ra,rb,"op +"); break;
+        case IR_SUB : emitRO("SUB",rd,ra,rb,"op -"); break;
+        case IR_MUL : emitRO("MUL",rd,ra,rb,"op *"); break;
+        case IR_DIV : emitRO("DIV",rd,ra,rb,"op /"); break;
+        default :
+          emitRO("SUB",rd,ra,rb,"compare");
+          emitRM(jumpOp(in->rel,FALSE),rd,2,pc,"br if true");
+          emitRM("LDC",rd,0,rd,"false case");
+          emitRM("LDA",pc,1,pc,"unconditional jmp");
+          emitRM("LDC",rd,1,rd,"true case");
+          break;
+      }
+      defDone(in->d);
+      break;
+
+    case IR_ADDR :
+      rd = def(in->d,0);
+      emitRM("LDA",rd,in->imm,in->imm >= 0 ? gp : fp,"load array address");
+      defDone(in->d);
+      break;
+
+    case IR_LOAD :
+      ra = use(in->a,0);
+      done(in->a);
+      rd = def(in->d,0);
+      emitRM("LD",rd,0,ra,"load element value");
+      defDone(in->d);
+      break;
+
+    case IR_STORE :
+      ra = use(in->a,0);
+      rb = use(in->b,1 << ra);
+      emitRM("ST",rb,0,ra,"store element value");
+      done(in->a);
+      done(in->b);
+      break;
+
+    case IR_GLOAD :
+      rd = def(in->d,0);
+      emitRM("LD",rd,in->var->memloc,gp,"load global");
+      defDone(in->d);
+      break;
+
+    case IR_GSTORE :
+      ra = use(in->a,0);
+      emitRM("ST",ra,in->var->memloc,gp,"store global");
+      done(in->a);
+      break;
+
+    case IR_IN :
+      rd = def(in->d,0);
+      emitRO("IN",rd,0,0,"input integer value");
+      defDone(in->d);
+      break;
+
+    case IR_OUT :
+      ra = use(in->a,0);
+      emitRO("OUT",ra,0,0,"output value");
+      done(in->a);
+      break;
+
+    case IR_ARG :
+      /* stored into the frame of the callee, which
+         starts where the frame of the caller ends */
+      ra = use(in->a,0);
+      addFixup("ST",ra,initFO - in->imm,NULL);
+      done(in->a);
+      break;
+
+    case IR_CALL :
+      flush();
+      addFixup("ST",fp,ofpFO,NULL);
+      addFixup("LDA",fp,0,NULL);
+      emitRM("LDA",ac,1,pc,"call: return address");
+      emitRM_Abs("LDA",pc,in->var->memloc,"call: jump to function");
+      emitRM("LD",fp,ofpFO,fp,"call: pop frame");
+      if (in->d != NO_VREG)
+      { regVreg[ac] = in->d;
+        inReg[in->d] = ac;
+        regDirty[ac] = TRUE;
+        defDone(in->d);
+      }
+      break;
+
+    case IR_JUMP :
+      writeBackAll();
+      if (in->t1 != next) addFixup("LDA",pc,0,in->t1);
+      break;
+
+    case IR_BRANCH :
+      ra = use(in->a,0);
+      if (in->b != NO_VREG)
+      { rb = use(in->b,1 << ra);
+        rd = getReg((1 << ra) | (1 << rb));
+        emitRO("SUB",rd,ra,rb,"compare");
+        ra = rd;
+      }
+      writeBackAll();
+      if (in->t2 == next)
+        addFixup(jumpOp(in->rel,FALSE),ra,0,in->t1);
+      else if (in->t1 == next)
+        addFixup(jumpOp(in->rel,TRUE),ra,0,in->t2);
+      else
+      { addFixup(jumpOp(in->rel,FALSE),ra,0,in->t1);
+        addFixup("LDA",pc,0,in->t2);
+      }
+      break;
+
+    case IR_RET :
+      if (in->a != NO_VREG)
+      { ra = use(in->a,0);
+        if (ra != ac) emitRM("LDA",ac,0,ra,"return: move value");
+      }
+      emitRM("LD",pc,retFO,fp,"return: to caller");
+      break;
+
+    default :
+      break;
+  }
+}
+
+/* Procedure lowerFunc generates code for f */
+static void lowerFunc( IrFunc * f )
+{ IrBlock * b;
+  IrInstr * in;
+  int v, r, i;
+  char buf[120];
+  curFunc = f;
+  slot = (int *) calloc(f->nvregs + 1,sizeof(int));
+  inReg = (int *) malloc((f->nvregs + 1) * sizeof(int));
+  isLocal = (char *) malloc(f->nvregs + 1);
+  lastUse = (int *) malloc((f->nvregs + 1) * sizeof(int));
+  if ((slot == NULL) || (inReg == NULL) || (isLocal == NULL)
+      || (lastUse == NULL))
+    lowerOutOfMemory();
+  for (v = 0; v < f->nvregs; v++) inReg[v] = -1;
+  /* parameters are where the caller stored them */
+  for (v = 0; v < f->nparams; v++) slot[v] = initFO - v;
+  nextSlot = initFO - f->frameSize;
+  nfixups = 0;
+  classify(f);
+  irLiveness(f);
+  if (TraceCode) emitComment("-> function") ;
+  emitFunction(f->decl->attr.name);
+  f->decl->memloc = emitSkip(0);
+  emitRM("ST",ac,retFO,fp,"function: store return address");
+  for (b = f->entry; b != NULL; b = b->next)
+  { b->loc = emitSkip(0);
+    curBlock = b;
+    for (r = 0; r < NO_TEMP_REGS; r++)
+    { regVreg[r] = -1;
+      regDirty[r] = FALSE;
+    }
+    /* the last uses of the other vregs in this block */
+    for (in = b->first; in != NULL; in = in->next)
+    { if ((in->a != NO_VREG) && !isLocal[in->a]) lastUse[in->a] = -1;
+      if ((in->b != NO_VREG) && !isLocal[in->b]) lastUse[in->b] = -1;
+      if ((in->d != NO_VREG) && !isLocal[in->d]) lastUse[in->d] = -1;
+    }
+    for (in = b->first, pos = 0; in != NULL; in = in->next, pos++)
+    { if ((in->a != NO_VREG) && !isLocal[in->a]) lastUse[in->a] = pos;
+      if ((in->b != NO_VREG) && !isLocal[in->b]) lastUse[in->b] = pos;
+    }
+    /* last uses are numbered within the block */
+    for (in = b->first, pos = 0; in != NULL; in = in->next, pos++)
+    { emitSourceLine(in->lineno);
+      if (TraceCode)
+      { irFormat(buf,f,in);
+        emitComment(buf);
+      }
+      lowerInstr(in,b->next);
+    }
+    for (r = 0; r < NO_TEMP_REGS; r++)
+      if (regVreg[r] >= 0) inReg[regVreg[r]] = -1;
+  }
+  /* nextSlot is now where the frame of a callee starts */
+  for (i = 0; i < nfixups; i++)
+  { emitBackup(fixups[i].loc);
+    if (fixups[i].target != NULL)
+      emitRM_Abs(fixups[i].op,fixups[i].r,fixups[i].target->loc,"jump");
+    else
+      emitRM(fixups[i].op,fixups[i].r,nextSlot + fixups[i].d,fp,
+             fixups[i].op[0] == 'L' ? "call: push frame"
+             : fixups[i].r == fp ? "call: store old fp"
+             : "call: store argument");
+  }
+  emitRestore();
+  emitFunction(NULL);
+  if (TraceCode) emitComment("<- function") ;
+  free(slot);
+  free(inReg);
+  free(isLocal);
+  free(lastUse);
+}
+
+/**********************************************/
+/* the primary function of the code generator */
+/**********************************************/
+/* Procedure irCodeGen generates TM code for the
+ * functions in funcs (see ir.h) to a code file,
+ * like codeGen does from the syntax tree. The
+ * second parameter (codefile) is the file name of
+ * the code file, and is used to print the file
+ * name as a comment in the code file
+ */
+void irCodeGen( IrFunc * funcs, char * codefile )
+{  char * s = malloc(strlen(codefile)+7);
+   IrFunc * f, * mainFunc = NULL;
+   int savedLoc;
+   strcpy(s,"File: ");
+   strcat(s,codefile);
+   emitComment("C-Minus Compilation to TM Code");
+   emitComment(s);
+   /* generate standard prelude */
+   emitComment("Standard prelude:");
+   emitRM("LD",mp,0,ac,"load maxaddress from location 0");
+   emitRM("ST",ac,0,ac,"clear location 0");
+   emitRM("LDA",fp,0,mp,"first frame at top of memory");
+   emitRM("ST",fp,ofpFO,fp,"call main: store old fp");
+   emitRM("LDA",ac,1,pc,"call main: return address");
+   savedLoc = emitSkip(1);
+   emitComment("call main: jump to main belongs here");
+   emitComment("End of execution.");
+   emitRO("HALT",0,0,0,"");
+   emitComment("End of standard prelude.");
+   /* generate code for the functions */
+   for (f = funcs; f != NULL; f = f->next)
+   { lowerFunc(f);
+     if (strcmp(f->decl->attr.name,"main") == 0) mainFunc = f;
+   }
+   emitBackup(savedLoc);
+   if (mainFunc != NULL)
+     emitRM_Abs("LDA",pc,mainFunc->decl->memloc,"call main: jump to main");
+   else
+   { fprintf(listing,"Code generation error: no main function\n");
+     emitRO("HALT",0,0,0,"no main function");
+   }
+   emitRestore();
+}
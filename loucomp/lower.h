@@ -0,0 +1,21 @@
+/****************************************************/
+/* File: lower.h                                    */
+/* Lowering of the intermediate representation to   */
+/* TM code for the C-Minus compiler                 */
+/****************************************************/
+
+#ifndef _LOWER_H_
+#define _LOWER_H_
+
+#include "ir.h"
+
+/* Procedure irCodeGen generates TM code for the
+ * functions in funcs (see ir.h) to a code file,
+ * like codeGen does from the syntax tree. The
+ * second parameter (codefile) is the file name of
+ * the code file, and is used to print the file
+ * name as a comment in the code file
+ */
+void irCodeGen( IrFunc * funcs, char * codefile );
+
+#endif
@@ -6,27 +6,32 @@
 /****************************************************/
 
 #include "globals.h"
+#include <time.h>
 
-/* set NO_PARSE to TRUE to get a scanner-only compiler */
-#define NO_PARSE FALSE 
 /* set NO_ANALYZE to TRUE to get a parser-only compiler */
 #define NO_ANALYZE FALSE 
 
 /* set NO_CODE to TRUE to get a compiler that does not
  * generate code
  */
-#define NO_CODE TRUE
+#define NO_CODE FALSE
 
 #include "util.h"
-#if NO_PARSE
+#include "intern.h"
+#include "symtab.h"
+#include "peep.h"
 #include "scan.h"
-#else
 #include "parse.h"
 #if !NO_ANALYZE
 #include "analyze.h"
 #if !NO_CODE
+#include "fold.h"
+#include "dead.h"
+#include "ir.h"
+#include "opt.h"
+#include "lower.h"
 #include "cgen.h"
-#endif
+#include "code.h"
 #endif
 #endif
 
@@ -43,16 +48,110 @@ int TraceParse = FALSE;
 int TraceAnalyze = TRUE;
 int TraceCode = FALSE;
 
+int BinaryCode = FALSE;
+int TraceOpt = FALSE;
+int ConstFold = TRUE;
+int UseIR = TRUE;
+int TraceIR = FALSE;
+int TraceMem = FALSE;
+int ScanOnly = FALSE;
+
+/* all peephole patterns and IR passes by default */
+int Peephole = PEEP_ALL;
+int IrOpt = OPT_ALL;
+int InlineLimit = 60;
+
 int Error = FALSE;
 
+/* the syntax tree of the compilation */
+Arena TreeArena;
+
+/* Procedure scanOnly scans the whole source without
+ * parsing it and reports how fast the scanner went
+ */
+static void scanOnly( void )
+{ long tokens = 0, bytes;
+  clock_t start;
+  double secs;
+  fseek(source,0,SEEK_END);
+  bytes = ftell(source);
+  rewind(source);
+  start = clock();
+  while (getToken() != ENDFILE) tokens++;
+  secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+  fprintf(listing,"\nScanned %ld tokens, %d lines, %ld bytes in %.3f s\n",
+          tokens,lineno,bytes,secs);
+  if (secs > 0)
+    fprintf(listing,"%.0f tokens/s, %.1f MB/s\n",
+            tokens / secs,bytes / secs / 1e6);
+}
+
 main( int argc, char * argv[] )
 { TreeNode * syntaxTree;
   char pgm[120]; /* source code file name */
-  if (argc != 2)
-    { fprintf(stderr,"usage: %s <filename>\n",argv[0]);
+  int argn = 1;
+  while ((argn < argc) && (argv[argn][0] == '-'))
+  { if (strcmp(argv[argn],"-b") == 0) BinaryCode = TRUE;
+    else if (strcmp(argv[argn],"-r") == 0) TraceOpt = TRUE;
+    else if (strcmp(argv[argn],"-f") == 0) ConstFold = FALSE;
+    else if (strcmp(argv[argn],"-t") == 0) UseIR = FALSE;
+    else if (strcmp(argv[argn],"-d") == 0) TraceIR = TRUE;
+    else if (strcmp(argv[argn],"-m") == 0) TraceMem = TRUE;
+    else if (strcmp(argv[argn],"-s") == 0) ScanOnly = TRUE;
+    else if (argv[argn][1] == 'p')
+    { /* -p followed by the peephole patterns to apply */
+      char * p = argv[argn] + 2;
+      Peephole = 0;
+      for (; *p != '\0'; p++)
+        if (*p == 's') Peephole |= PEEP_STORELOAD;
+        else if (*p == 'j') Peephole |= PEEP_JUMPNEXT;
+        else if (*p == 'c') Peephole |= PEEP_COMPARE;
+        else if (*p == 't') Peephole |= PEEP_THREAD;
+        else if (*p == 'u') Peephole |= PEEP_UNREACH;
+        else break;
+      if (*p != '\0') break;
+    }
+    else if ((argv[argn][1] == 'i') && isdigit(argv[argn][2]))
+      InlineLimit = atoi(argv[argn] + 2);
+    else if (argv[argn][1] == 'o')
+    { /* -o followed by the IR passes to run */
+      char * p = argv[argn] + 2;
+      IrOpt = 0;
+      for (; *p != '\0'; p++)
+        if (*p == 'c') IrOpt |= OPT_SCCP;
+        else if (*p == 'd') IrOpt |= OPT_DCE;
+        else if (*p == 'l') IrOpt |= OPT_LOOP;
+        else if (*p == 'i') IrOpt |= OPT_INLINE;
+        else if (*p == 't') IrOpt |= OPT_TAIL;
+        else break;
+      if (*p != '\0') break;
+    }
+    else break;
+    argn++;
+  }
+  if ((argn != argc - 1) || (strlen(argv[argn]) + 5 > sizeof(pgm)))
+    { fprintf(stderr,"usage: %s [-b] [-r] [-f] [-t] [-d] [-m] [-s] [-p[sjctu]] [-o[cdlit]] [-i<n>] <filename>\n",
+              argv[0]);
+      fprintf(stderr,"  -b  also write a binary TM image (.tmb)\n");
+      fprintf(stderr,"  -r  report what the optimizations did\n");
+      fprintf(stderr,"  -f  do not fold constant expressions\n");
+      fprintf(stderr,"  -t  generate code directly from the syntax tree\n");
+      fprintf(stderr,"  -d  print the intermediate code to the listing\n");
+      fprintf(stderr,"  -m  report the memory used by the syntax tree\n");
+      fprintf(stderr,"  -s  only scan the source and report the speed\n");
+      fprintf(stderr,"  -p  apply only the peephole patterns listed:"
+                     " s(tore/load) j(ump to next)\n"
+                     "      c(ompare/branch) t(hreading)"
+                     " u(nreachable); -p alone turns it off\n");
+      fprintf(stderr,"  -o  run only the IR passes listed:"
+                     " c(onstant propagation)\n"
+                     "      d(ead code) l(oops) i(nlining)"
+                     " t(ail calls); -o alone turns them off\n");
+      fprintf(stderr,"  -i  inline functions of at most n nodes"
+                     " (default %d)\n",InlineLimit);
       exit(1);
     }
-  strcpy(pgm,argv[1]) ;
+  strcpy(pgm,argv[argn]) ;
   if (strchr (pgm, '.') == NULL)
      strcat(pgm,".tny");
   source = fopen(pgm,"r");
@@ -62,9 +161,11 @@ main( int argc, char * argv[] )
   }
   listing = stdout; /* send listing to screen */
   fprintf(listing,"\nC-MINUS COMPILATION: %s\n",pgm);
-#if NO_PARSE
-  while (getToken()!=ENDFILE);
-#else
+  if (ScanOnly)
+  { scanOnly();
+    fclose(source);
+    return 0;
+  }
   syntaxTree = parse();
   if (TraceParse) {
     fprintf(listing,"\nSyntax tree:\n");
@@ -82,7 +183,7 @@ main( int argc, char * argv[] )
   if (! Error)
   { char * codefile;
     int fnlen = strcspn(pgm,".");
-    codefile = (char *) calloc(fnlen+4, sizeof(char));
+    codefile = (char *) calloc(fnlen+5, sizeof(char));
     strncpy(codefile,pgm,fnlen);
     strcat(codefile,".tm");
     code = fopen(codefile,"w");
@@ -90,12 +191,43 @@ main( int argc, char * argv[] )
     { printf("Unable to open %s\n",codefile);
       exit(1);
     }
-    codeGen(syntaxTree,codefile);
+    if (ConstFold) foldConst(syntaxTree);
+    if (IrOpt & OPT_DCE) removeDead(syntaxTree);
+    if (UseIR)
+    { IrFunc * ir = irBuild(syntaxTree);
+      irOptimize(ir);
+      if (TraceIR)
+      { fprintf(listing,"\nIntermediate code:\n");
+        irPrint(ir);
+      }
+      irCodeGen(ir,codefile);
+    }
+    else
+      codeGen(syntaxTree,codefile);
+    emitFlush();
+    emitLineTable();
     fclose(code);
+    if (BinaryCode)
+    { FILE * obj;
+      strcat(codefile,"b");
+      obj = fopen(codefile,"wb");
+      if (obj == NULL)
+      { printf("Unable to open %s\n",codefile);
+        exit(1);
+      }
+      emitObject(obj);
+      fclose(obj);
+    }
   }
 #endif
 #endif
-#endif
+  if (TraceMem)
+  { arenaStats(&TreeArena,"Syntax tree");
+    internStats();
+    printSymStats(listing);
+  }
+  internFree();
+  arenaFree(&TreeArena);
   fclose(source);
   return 0;
 }
@@ -0,0 +1,52 @@
+/****************************************************/
+/* File: opt.c                                      */
+/* Optimization passes on the intermediate          */
+/* representation for the C-Minus compiler          */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+#include "sccp.h"
+#include "live.h"
+#include "loop.h"
+#include "opt.h"
+
+/* Procedure irOptimize runs the optimization passes
+ * selected by IrOpt on the functions in funcs
+ */
+void irOptimize( IrFunc * funcs )
+{ IrFunc * f;
+  SccpStats sccpStats;
+  DceStats dceStats;
+  LoopStats loopStats;
+  memset(&sccpStats,0,sizeof(sccpStats));
+  memset(&dceStats,0,sizeof(dceStats));
+  memset(&loopStats,0,sizeof(loopStats));
+  for (f = funcs; f != NULL; f = f->next)
+  { if (IrOpt & OPT_SCCP)
+    { ssaBuild(f);
+      sccp(f,&sccpStats);
+      ssaDestroy(f);
+      irMergeBlocks(f);
+    }
+    if (IrOpt & OPT_DCE) deadCode(f,&dceStats);
+    if (IrOpt & OPT_LOOP)
+    { loopOpt(f,&loopStats);
+      /* the invariants left in the loops may be dead */
+      if (IrOpt & OPT_DCE) deadCode(f,&dceStats);
+    }
+  }
+  if (TraceOpt && (IrOpt & OPT_SCCP))
+    fprintf(listing,"\nConstant propagation: %d values constant,"
+                    " %d branches decided, %d blocks removed\n",
+            sccpStats.consts,sccpStats.branches,sccpStats.blocks);
+  if (TraceOpt && (IrOpt & OPT_LOOP))
+    fprintf(listing,"\nLoop optimization: %d loops, %d invariants hoisted,"
+                    " %d computations reused\n",
+            loopStats.loops,loopStats.hoisted,loopStats.reused);
+  if (TraceOpt && (IrOpt & OPT_DCE))
+    fprintf(listing,"\nDead code elimination: %d instructions removed,"
+                    " %d global stores removed\n",
+            dceStats.instrs,dceStats.stores);
+}
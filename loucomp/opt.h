@@ -0,0 +1,18 @@
+/****************************************************/
+/* File: opt.h                                      */
+/* Optimization passes on the intermediate          */
+/* representation for the C-Minus compiler          */
+/****************************************************/
+
+#ifndef _OPT_H_
+#define _OPT_H_
+
+#include "ir.h"
+
+/* Procedure irOptimize runs the optimization passes
+ * selected by IrOpt (OPT_ flags in ir.h) on the
+ * functions in funcs
+ */
+void irOptimize( IrFunc * funcs );
+
+#endif
@@ -0,0 +1,267 @@
+/****************************************************/
+/* File: peep.c                                     */
+/* Peephole optimizer for the C-Minus compiler      */
+/* (works on the buffered TM code)                  */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+#include "peep.h"
+
+/* While optimizing, every pc-relative reference
+ * (a jump, or an LDA computing a return address)
+ * is kept as the absolute location it refers to in
+ * target, and the number of references to each
+ * location in refs. Removed instructions are marked
+ * in dead; they are squeezed out at the end, when
+ * the references are converted back.
+ */
+static INSTRUCTION * c;
+static int size;
+static int * target;
+static int * refs;
+static char * dead;
+static char * entered;
+
+/* number of times each pattern applied */
+static int applied[5];
+static char * patternName[5]
+        = {"store/load","jump to next","compare/branch",
+           "jump threading","unreachable code"};
+
+/* Function isPcRel tells whether instruction i
+ * refers to a location relative to pc
+ */
+static int isPcRel( int i )
+{ return (c[i].iop >= opLD) && (c[i].iop != opRMLim)
+         && (c[i].iop != opLDC) && (c[i].iop < opRALim)
+         && (c[i].iarg3 == pc);
+}
+
+/* Function isJump tells whether instruction i is a
+ * jump to target[i] (conditional or not)
+ */
+static int isJump( int i )
+{ if (target[i] < 0) return FALSE;
+  if (c[i].iop == opLDA) return c[i].iarg1 == pc;
+  return (c[i].iop >= opJLT) && (c[i].iop <= opJNE);
+}
+
+/* Function isGoto tells whether instruction i
+ * never falls through to the next one
+ */
+static int isGoto( int i )
+{ if (c[i].iop == opHALT) return TRUE;
+  if ((c[i].iop == opLD) || (c[i].iop == opLDA) || (c[i].iop == opLDC))
+    return c[i].iarg1 == pc;
+  return FALSE;
+}
+
+/* Function next returns the first live location
+ * after i (size if there is none)
+ */
+static int next( int i )
+{ do i++; while ((i < size) && dead[i]);
+  return i;
+}
+
+/* Function isLabel tells whether control can reach
+ * i other than by falling through
+ */
+static int isLabel( int i )
+{ return (i < size) && (entered[i] || (refs[i] > 0));
+}
+
+/* Procedure countRefs recomputes refs from the
+ * live instructions
+ */
+static void countRefs( void )
+{ int i;
+  for (i = 0; i <= size; i++) refs[i] = 0;
+  for (i = 0; i < size; i++)
+    if (!dead[i] && (target[i] >= 0)) refs[target[i]]++;
+}
+
+/* Procedure kill removes instruction i */
+static void kill( int i )
+{ dead[i] = TRUE;
+  if (target[i] >= 0) refs[target[i]]--;
+}
+
+/* Function inverse returns the conditional jump
+ * taken exactly when jump op is not
+ */
+static int inverse( int op )
+{ switch (op) {
+    case opJLT : return opJGE;
+    case opJLE : return opJGT;
+    case opJGT : return opJLE;
+    case opJGE : return opJLT;
+    case opJEQ : return opJNE;
+    default :    return opJEQ;
+  }
+}
+
+/* Function storeLoad replaces a load of the location
+ * just stored by a register move (or nothing)
+ */
+static int storeLoad( int i )
+{ int j = next(i);
+  if ((c[i].iop != opST) || (c[i].iarg3 == pc) || (j >= size)
+      || (c[j].iop != opLD) || isLabel(j)
+      || (c[j].iarg2 != c[i].iarg2) || (c[j].iarg3 != c[i].iarg3))
+    return FALSE;
+  if (c[j].iarg1 == pc) return FALSE;
+  if (c[j].iarg1 == c[i].iarg1)
+    kill(j);
+  else
+  { c[j].iop = opLDA;
+    c[j].iarg2 = 0;
+    c[j].iarg3 = c[i].iarg1;
+  }
+  applied[0]++;
+  return TRUE;
+}
+
+/* Function jumpNext removes a jump to the next
+ * live instruction
+ */
+static int jumpNext( int i )
+{ if (!isJump(i) || (next(i) != next(target[i] - 1))) return FALSE;
+  if (target[i] <= i) return FALSE;
+  kill(i);
+  applied[1]++;
+  return TRUE;
+}
+
+/* Function compare turns the sequence
+ *    SUB r,a,b; Jxx r,2(pc); LDC r,0; LDA pc,1(pc);
+ *    LDC r,1; JEQ r,L
+ * that genExp and an if or while test generate into
+ *    SUB r,a,b; J(not xx) r,L
+ * (the 0/1 value of the test is not used after it)
+ */
+static int compare( int i )
+{ int j1 = next(i), j2 = next(j1), j3 = next(j2), j4 = next(j3);
+  int j5 = next(j4);
+  if ((c[i].iop != opSUB) || (j5 >= size)) return FALSE;
+  if (!isJump(j1) || (c[j1].iop == opLDA) || (target[j1] != j4)
+      || (c[j2].iop != opLDC) || (c[j2].iarg2 != 0)
+      || !isJump(j3) || (c[j3].iop != opLDA) || (target[j3] != j5)
+      || (c[j4].iop != opLDC) || (c[j4].iarg2 != 1)
+      || !isJump(j5) || (c[j5].iop != opJEQ))
+    return FALSE;
+  if ((c[j1].iarg1 != c[i].iarg1) || (c[j2].iarg1 != c[i].iarg1)
+      || (c[j4].iarg1 != c[i].iarg1) || (c[j5].iarg1 != c[i].iarg1))
+    return FALSE;
+  if (isLabel(j1) || isLabel(j2) || isLabel(j3)
+      || (refs[j4] != 1) || (refs[j5] != 1) || entered[j4] || entered[j5])
+    return FALSE;
+  c[j1].iop = inverse(c[j1].iop);
+  refs[target[j1]]--;
+  target[j1] = target[j5];
+  refs[target[j1]]++;
+  kill(j2);
+  kill(j3);
+  kill(j4);
+  kill(j5);
+  applied[2]++;
+  return TRUE;
+}
+
+/* Function thread retargets a jump to an
+ * unconditional jump to the final destination
+ */
+static int thread( int i )
+{ int t, hops = 0;
+  if (!isJump(i)) return FALSE;
+  t = target[i];
+  if ((t < size) && dead[t]) t = next(t);
+  while ((t < size) && isJump(t) && (c[t].iop == opLDA)
+         && (target[t] != t) && (hops++ < size))
+  { t = target[t];
+    if ((t < size) && dead[t]) t = next(t);
+  }
+  if (t == target[i]) return FALSE;
+  refs[target[i]]--;
+  target[i] = t;
+  refs[t]++;
+  applied[3]++;
+  return TRUE;
+}
+
+/* Function unreachable removes the instructions
+ * after an unconditional jump up to the next label
+ */
+static int unreachable( int i )
+{ int j = next(i), changed = FALSE;
+  if (!isGoto(i)) return FALSE;
+  while ((j < size) && !isLabel(j))
+  { kill(j);
+    changed = TRUE;
+    j = next(j);
+  }
+  if (changed) applied[4]++;
+  return changed;
+}
+
+/* Function peephole optimizes the buffered code */
+int peephole( INSTRUCTION * code, int n, char * entry, int * newLoc )
+{ int i, changed, loc, p, before = n;
+  int patterns = Peephole;
+  c = code;
+  size = n;
+  entered = entry;
+  target = (int *) malloc((n + 1) * sizeof(int));
+  refs = (int *) malloc((n + 1) * sizeof(int));
+  dead = (char *) calloc(n + 1, 1);
+  if ((target == NULL) || (refs == NULL) || (dead == NULL))
+  { fprintf(listing,"Out of memory error in peephole optimizer\n");
+    exit(1);
+  }
+  for (p = 0; p < 5; p++) applied[p] = 0;
+  for (i = 0; i < n; i++)
+  { target[i] = isPcRel(i) ? i + 1 + c[i].iarg2 : -1;
+    if (isPcRel(i) && ((target[i] < 0) || (target[i] > n)))
+      /* refers outside the code: leave the code alone */
+      patterns = 0;
+  }
+  countRefs();
+  do
+  { changed = FALSE;
+    for (i = 0; i < n; i++)
+    { if (dead[i]) continue;
+      /* at most one pattern per instruction and sweep */
+      if (((patterns & PEEP_COMPARE) && compare(i))
+          || ((patterns & PEEP_STORELOAD) && storeLoad(i))
+          || ((patterns & PEEP_THREAD) && thread(i))
+          || ((patterns & PEEP_JUMPNEXT) && jumpNext(i))
+          || ((patterns & PEEP_UNREACH) && unreachable(i)))
+        changed = TRUE;
+    }
+    countRefs();
+  } while (changed);
+  /* squeeze out the removed instructions */
+  loc = 0;
+  for (i = 0; i <= n; i++)
+  { newLoc[i] = loc;
+    if ((i < n) && !dead[i]) loc++;
+  }
+  for (i = 0; i < n; i++)
+    if (!dead[i])
+    { if (target[i] >= 0)
+        c[i].iarg2 = newLoc[target[i]] - (newLoc[i] + 1);
+      c[newLoc[i]] = c[i];
+    }
+  if (TraceOpt)
+  { fprintf(listing,"\nPeephole optimization: %d of %d instructions removed\n",
+            before - loc, before);
+    for (p = 0; p < 5; p++)
+      if (applied[p] > 0)
+        fprintf(listing,"   %-18s %5d times\n",patternName[p],applied[p]);
+  }
+  free(target);
+  free(refs);
+  free(dead);
+  return loc;
+}
@@ -0,0 +1,32 @@
+/****************************************************/
+/* File: peep.h                                     */
+/* Peephole optimizer interface for the C-Minus     */
+/* compiler (works on the buffered TM code)         */
+/****************************************************/
+
+#ifndef _PEEP_H_
+#define _PEEP_H_
+
+#include "tmobj.h"
+
+/* peephole patterns, selected by the Peephole flags */
+#define PEEP_STORELOAD  1  /* ST r,d(s) then LD r2,d(s) */
+#define PEEP_JUMPNEXT   2  /* jump to the next instruction */
+#define PEEP_COMPARE    4  /* 0/1 comparison tested by JEQ */
+#define PEEP_THREAD     8  /* jump to an unconditional jump */
+#define PEEP_UNREACH   16  /* code after an unconditional jump */
+#define PEEP_ALL       31
+
+/* Function peephole optimizes the n instructions
+ * in code, removing instructions and relocating
+ * every pc-relative reference. Locations marked in
+ * entry (location 0, function entry points) are
+ * entered from elsewhere and stay reachable.
+ * newLoc[loc] receives the new location of loc
+ * (or of the next instruction kept, if loc was
+ * removed) for loc = 0..n. Returns the new number
+ * of instructions.
+ */
+int peephole( INSTRUCTION * code, int n, char * entry, int * newLoc );
+
+#endif
@@ -1,6 +1,7 @@
 /****************************************************/
 /* File: scan.c                                     */
-/* The scanner implementation for the TINY compiler */
+/* Hand-coded scanner for C-Minus, an alternative   */
+/* to the flex scanner (see SCANOBJ in Makefile)    */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
@@ -8,311 +9,207 @@
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
+#include "intern.h"
 
-/* states in scanner DFA */
-typedef enum
-   { START,INEQ,INCOMMENT,INNUM,INID,DONE,INLT,INGT,INNE,INOVER,INCOMMENT_ }
-   StateType;
+/* the last token (see scan.h) */
+char * tokenText;
+int tokenLen;
+int tokenValue;
+char * tokenName;
 
-/* lexeme of identifier or reserved word */
-char tokenString[MAXTOKENLEN+1];
+/* BUFLEN = initial length of the input buffer; the
+   source is read in blocks that fill the buffer */
+#define BUFLEN 65536
 
-/* BUFLEN = length of the input buffer for
-   source code lines */
-#define BUFLEN 256
-
-static char lineBuf[BUFLEN]; /* holds the current line */
-static int linepos = 0; /* current position in LineBuf */
-static int bufsize = 0; /* current size of buffer string */
-static int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
+/* buf holds the text from tokenStart up to lim, and
+ * a null character at lim stops every loop in the
+ * DFA at the end of the text read so far
+ */
+static char * buf = NULL;
+static size_t bufsize = 0; /* allocated size of buf */
+static char * lim; /* end of the text in buf */
+static char * pos; /* where the next token starts */
+static char * tokenStart; /* first character kept in buf */
+static int EOF_flag = FALSE; /* the whole source has been read */
+
+/* the null character written after the last token
+   and the character it replaced */
+static char * holdPos = NULL;
+static char holdChar;
+
+static void scanOutOfMemory(void)
+{ fprintf(listing,"Out of memory error reading the source\n");
+  exit(1);
+}
 
-/* getNextChar fetches the next non-blank character
-   from lineBuf, reading in a new line if lineBuf is
-   exhausted */
-static int getNextChar(void)
-{ if (!(linepos < bufsize))
-  { lineno++;
-    if (fgets(lineBuf,BUFLEN-1,source))
-    { if (EchoSource) fprintf(listing,"%4d: %s",lineno,lineBuf);
-      bufsize = strlen(lineBuf);
-      linepos = 0;
-      return lineBuf[linepos++];
-    }
-    else
-    { EOF_flag = TRUE;
-      return EOF;
-    }
+/* Function fillBuffer reads the next block of the
+ * source into buf, first moving the text from
+ * tokenStart to the front (the buffer doubles when
+ * that text fills it); *p points into buf and is
+ * moved with it; returns FALSE at end of file
+ */
+static int fillBuffer(char ** p)
+{ size_t keep = lim - tokenStart, n;
+  if (EOF_flag) return FALSE;
+  if (keep + 1 >= bufsize)
+  { char * newbuf = (char *) malloc(bufsize * 2);
+    if (newbuf == NULL) scanOutOfMemory();
+    memcpy(newbuf,tokenStart,keep);
+    free(buf);
+    buf = newbuf;
+    bufsize *= 2;
   }
-  else return lineBuf[linepos++];
+  else memmove(buf,tokenStart,keep);
+  *p = buf + (*p - tokenStart);
+  tokenStart = buf;
+  n = fread(buf + keep,1,bufsize - keep - 1,source);
+  lim = buf + keep + n;
+  *lim = '\0';
+  if (n == 0) EOF_flag = TRUE;
+  return n > 0;
 }
 
-/* ungetNextChar backtracks one character
-   in lineBuf */
-static void ungetNextChar(void)
-{ if (!EOF_flag) linepos-- ;}
-
-/* lookup table of reserved words */
-static struct
-    { char* str;
-      TokenType tok;
-    } reservedWords[MAXRESERVED]
-   = {{"if",IF},{"else",ELSE},{"while",WHILE},{"return",RETURN},{"int",INT},{"void",VOID},
-      /* discarded */ {"then",THEN},{"end",END},{"repeat",REPEAT},{"until",UNTIL},{"read",READ},{"write",WRITE}
-     };
-
-/* lookup an identifier to see if it is a reserved word */
-/* uses linear search */
-static TokenType reservedLookup (char * s)
-{ int i;
-  for (i=0;i<MAXRESERVED;i++)
-    if (!strcmp(s,reservedWords[i].str))
-      return reservedWords[i].tok;
-  return ID;
-}
+/* reservedLookup finds reserved words with the
+   minimal perfect hash generated by kwgen */
+#include "reserved.h"
 
 /****************************************/
 /* the primary function of the scanner  */
 /****************************************/
-/* function getToken returns the 
- * next token in source file
+/* function getToken returns the
+ * next token in source file; the states of the
+ * DFA are the cases and loops below, which run
+ * on the buffer directly and call fillBuffer only
+ * when they reach lim
  */
 TokenType getToken(void)
-{  /* index for storing into tokenString */
-   int tokenStringIndex = 0;
-   /* holds current token to be returned */
-   TokenType currentToken;
-   /* current state - always begins at START */
-   StateType state = START;
-   /* flag to indicate save to tokenString */
-   int save;
-   while (state != DONE)
-   { int c = getNextChar();
-     save = TRUE;
-     switch (state)
-     { case START:
-         if (isdigit(c))
-           state = INNUM;
-         else if (isalpha(c))
-           state = INID;
-
-         else if ((c == ' ') || (c == '\t') || (c == '\n'))
-           save = FALSE;
-
-         else if (c == '/')
-         { save = FALSE;
-           state = INOVER;
-         }
-
-	 else if (c == '<')
-	{
-	   state = INLT;
-	}
-
-	 else if (c == '>')
-	{
-	   state = INGT;
-	}
-
-	 else if (c == '=')
-	{
-	   state = INEQ;
-	}
-
-	 else if (c == '!')
-	{
-	   state = INNE;
-	}
-
-         else
-         { state = DONE;
-           switch (c)
-           { case EOF:
-               save = FALSE;
-               currentToken = ENDFILE;
-               break;
-             case '+':
-               currentToken = PLUS;
-               break;
-             case '-':
-               currentToken = MINUS;
-               break;
-             case '*':
-               currentToken = TIMES;
-               break;
-             case '(':
-               currentToken = LPAREN;
-               break;
-             case ')':
-               currentToken = RPAREN;
-               break;
-             case '{':
-               currentToken = LCURLY;
-               break;
-             case '}':
-               currentToken = RCURLY;
-               break;
-             case '[':
-               currentToken = LBRACE;
-               break;
-             case ']':
-               currentToken = RBRACE;
-               break;
-             case ';':
-               currentToken = SEMI;
-               break;
-             case ',':
-               currentToken = COMMA;
-               break;
-             default:
-               currentToken = ERROR;
-               break;
-           }
-         }
-         break;
-       case INNUM:
-         if (!isdigit(c))
-         { /* backup in the input */
-           ungetNextChar();
-           save = FALSE;
-           state = DONE;
-           currentToken = NUM;
-         }
-         break;
-       case INID:
-         if (!isalpha(c))
-         { /* backup in the input */
-           ungetNextChar();
-           save = FALSE;
-           state = DONE;
-           currentToken = ID;
-         }
-         break;
-
-	case INEQ:
-	   state = DONE;
-   	   if (c == '=')
-	   {
-		currentToken = EQ;
-	   }
-	   else
-	   {
-		ungetNextChar();
-		save = FALSE;
-		currentToken = ASSIGN;
- 	   }
-	
-	break;
-
-	case INCOMMENT:
-	    save = FALSE;
-	    if (c == '*')	
-	    {
-		state = INCOMMENT_;
-	    }
-	    else if(c == EOF)
-	    {
-		state = DONE;
-		currentToken = ENDFILE;
-	    }
-	break;
-
-	case INCOMMENT_:
-	    save = FALSE;
-	    if (c == '/')
-	    {
-		state = START;
-	    }
-
-	    else if(c == EOF)
-	    {
-		state = DONE;
-		currentToken = ENDFILE;
-	    }
-	
-	    else if(c != '*')
-	    {
-		state = INCOMMENT;
- 	    }
-	break;
-
-	case INLT:
-	   state = DONE;
-	   if (c == '=')
-	   {
-		currentToken = LE;
-	   }
-	   else
-	   {
-		ungetNextChar();
-		save = FALSE;
-		currentToken = LT;
-	   }
-
-	break;
-
-	case INGT:
-	   state = DONE;
-	   if (c == '=')
-	   {
-		currentToken = GE;
-	   }
-	   else
-	   {
-		ungetNextChar();
-		save = FALSE;
-		currentToken = GT;
-	   }
-	break;
-
-	case INNE:
-	   state = DONE;
-	   if (c == '=')
-	   {
-		currentToken = NE;
-	   }
-	   else
-	   {
-		ungetNextChar();
-		save = FALSE;
-		currentToken = ERROR;
-	   }
-	break;
-
-	case INOVER:
-	    save = FALSE;
-	    if (c == '*')
-	    {
-	    	state = INCOMMENT;
-	    }
-	    else
-	    {
-		state = DONE;
-	   	ungetNextChar();
-		currentToken = OVER;
-   	    }
-	
-	break;
-
-
-       case DONE:
-       default: /* should never happen */
-         fprintf(listing,"Scanner Bug: state= %d\n",state);
-         state = DONE;
-         currentToken = ERROR;
-         break;
-     }
-     if ((save) && (tokenStringIndex <= MAXTOKENLEN))
-       tokenString[tokenStringIndex++] = (char) c;
-     if (state == DONE)
-     { tokenString[tokenStringIndex] = '\0';
-       if (currentToken == ID)
-         currentToken = reservedLookup(tokenString);
-     }
-   }
-   if (TraceScan) {
-     fprintf(listing,"\t%d: ",lineno);
-     printToken(currentToken,tokenString);
-   }
-   return currentToken;
+{ /* holds current token to be returned */
+  TokenType currentToken;
+  /* the next character to look at */
+  char * p;
+  int c, star;
+  if (buf == NULL)
+  { lineno++;
+    bufsize = BUFLEN;
+    buf = (char *) malloc(bufsize);
+    if (buf == NULL) scanOutOfMemory();
+    pos = tokenStart = lim = buf;
+    *lim = '\0';
+  }
+  if (holdPos != NULL) *holdPos = holdChar;
+  p = pos;
+  for (;;)
+  { tokenStart = p;
+    c = (unsigned char) *p++;
+    if (isalpha(c))
+    { do
+      { while (isalpha((unsigned char) *p)) p++;
+      } while ((p == lim) && fillBuffer(&p));
+      currentToken = ID;
+      break;
+    }
+    if (isdigit(c))
+    { do
+      { while (isdigit((unsigned char) *p)) p++;
+      } while ((p == lim) && fillBuffer(&p));
+      currentToken = NUM;
+      break;
+    }
+    switch (c)
+    { case ' ':
+      case '\t':
+        continue;
+      case '\n':
+        lineno++;
+        continue;
+      case '=':
+        if (p == lim) fillBuffer(&p);
+        if (*p == '=') { p++; currentToken = EQ; }
+        else currentToken = ASSIGN;
+        break;
+      case '<':
+        if (p == lim) fillBuffer(&p);
+        if (*p == '=') { p++; currentToken = LE; }
+        else currentToken = LT;
+        break;
+      case '>':
+        if (p == lim) fillBuffer(&p);
+        if (*p == '=') { p++; currentToken = GE; }
+        else currentToken = GT;
+        break;
+      case '!':
+        if (p == lim) fillBuffer(&p);
+        if (*p == '=') { p++; currentToken = NE; }
+        else currentToken = ERROR;
+        break;
+      case '/':
+        if (p == lim) fillBuffer(&p);
+        if (*p != '*')
+        { currentToken = OVER;
+          break;
+        }
+        /* comment: skip to the closing star-slash */
+        p++;
+        star = FALSE;
+        for (;;)
+        { if (p == lim)
+          { tokenStart = p;
+            if (!fillBuffer(&p)) break;
+          }
+          c = *p++;
+          if (c == '\n') { lineno++; star = FALSE; }
+          else if (c == '*') star = TRUE;
+          else if (star && (c == '/')) break;
+          else star = FALSE;
+        }
+        continue;
+      case '+': currentToken = PLUS; break;
+      case '-': currentToken = MINUS; break;
+      case '*': currentToken = TIMES; break;
+      case '(': currentToken = LPAREN; break;
+      case ')': currentToken = RPAREN; break;
+      case '{': currentToken = LCURLY; break;
+      case '}': currentToken = RCURLY; break;
+      case '[': currentToken = LBRACE; break;
+      case ']': currentToken = RBRACE; break;
+      case ';': currentToken = SEMI; break;
+      case ',': currentToken = COMMA; break;
+      case '\0':
+        if (p - 1 == lim)
+        { p--;
+          if (fillBuffer(&p)) continue;
+          currentToken = ENDFILE;
+          break;
+        }
+        currentToken = ERROR;
+        break;
+      default:
+        currentToken = ERROR;
+        break;
+    }
+    break;
+  }
+  tokenText = tokenStart;
+  tokenLen = p - tokenStart;
+  holdPos = p;
+  holdChar = *p;
+  *p = '\0';
+  pos = p;
+  if (currentToken == NUM)
+  { unsigned value = 0;
+    int i;
+    for (i = 0; i < tokenLen; i++)
+      value = 10 * value + (tokenText[i] - '0');
+    tokenValue = (int) value;
+  }
+  else if (currentToken == ID)
+  { currentToken = reservedLookup(tokenText,tokenLen);
+    if (currentToken == ID)
+      tokenName = internText(tokenText,tokenLen);
+  }
+  if (TraceScan) {
+    fprintf(listing,"\t%d: ",lineno);
+    printToken(currentToken,tokenText);
+  }
+  return currentToken;
 } /* end getToken */
-
@@ -8,11 +8,21 @@
 #ifndef _SCAN_H_
 #define _SCAN_H_
 
-/* MAXTOKENLEN is the maximum size of a token */
-#define MAXTOKENLEN 40
+/* tokenText and tokenLen give the lexeme of the
+ * last token as a slice of the source, which is
+ * followed by a null character until the next
+ * token is read; nothing is copied
+ */
+extern char * tokenText;
+extern int tokenLen;
+
+/* tokenValue is the value of the last NUM token */
+extern int tokenValue;
 
-/* tokenString array stores the lexeme of each token */
-extern char tokenString[MAXTOKENLEN+1];
+/* tokenName is the interned name (intern.h) of the
+ * last ID token
+ */
+extern char * tokenName;
 
 /* function getToken returns the 
  * next token in source file
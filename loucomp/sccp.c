@@ -0,0 +1,403 @@
+/****************************************************/
+/* File: sccp.c                                     */
+/* Sparse conditional constant propagation on the   */
+/* intermediate representation in SSA form          */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+#include "sccp.h"
+#include <limits.h>
+
+/* the lattice value of a vreg: TOP (no executable
+   definition seen yet), CONST (one constant) or
+   BOTTOM (not a constant) */
+typedef enum { TOP, CONST, BOTTOM } Lattice;
+
+static Lattice * state;
+static int * value;
+
+/* the definition of each vreg and its block */
+static IrInstr ** defInstr;
+static IrBlock ** defBlock;
+
+/* the instructions using each vreg (phis included),
+   and their blocks: uses[useStart[v]..useStart[v+1]-1] */
+typedef struct
+   { IrInstr * in;
+     IrBlock * blk;
+   } USE;
+
+static USE * uses;
+static int * useStart;
+
+/* the executable blocks, and the executable edges
+   into each block, by predecessor index */
+static char * execBlock;
+static char ** execEdge;
+
+/* the CFG worklist holds edges (from may be NULL
+   for the entry), the SSA worklist vregs */
+typedef struct
+   { IrBlock * from, * to;
+   } EDGE;
+
+static EDGE * flowWork;
+static int nflow, maxflow;
+static int * ssaWork;
+static int nssa, maxssa;
+
+static void sccpOutOfMemory( void )
+{ fprintf(listing,"Out of memory error in constant propagation\n");
+  exit(1);
+}
+
+static void * sccpAlloc( int n, int size )
+{ void * p = calloc(n > 0 ? n : 1,size);
+  if (p == NULL) sccpOutOfMemory();
+  return p;
+}
+
+/* Function predIndex returns the index of p among
+ * the predecessors of b
+ */
+static int predIndex( IrBlock * b, IrBlock * p )
+{ int k;
+  for (k = 0; b->pred[k] != p; k++) ;
+  return k;
+}
+
+static void addEdge( IrBlock * from, IrBlock * to )
+{ if (nflow == maxflow)
+  { maxflow = 2 * maxflow + 16;
+    flowWork = (EDGE *) realloc(flowWork,maxflow * sizeof(EDGE));
+    if (flowWork == NULL) sccpOutOfMemory();
+  }
+  flowWork[nflow].from = from;
+  flowWork[nflow].to = to;
+  nflow++;
+}
+
+/* Procedure lower moves vreg v down the lattice to
+ * st (with constant c), queueing its uses if it
+ * changed
+ */
+static void lower( int v, Lattice st, int c )
+{ if ((state[v] == CONST) && (st == CONST) && (value[v] != c))
+    st = BOTTOM;
+  /* the values only move down */
+  if (st <= state[v]) return;
+  state[v] = st;
+  value[v] = c;
+  if (nssa == maxssa)
+  { maxssa = 2 * maxssa + 16;
+    ssaWork = (int *) realloc(ssaWork,maxssa * sizeof(int));
+    if (ssaWork == NULL) sccpOutOfMemory();
+  }
+  ssaWork[nssa++] = v;
+}
+
+/* Function evalRel evaluates a rel b */
+static int evalRel( TokenType rel, int a, int b )
+{ switch (rel) {
+    case LT : return a < b;
+    case LE : return a <= b;
+    case GT : return a > b;
+    case GE : return a >= b;
+    case EQ : return a == b;
+    default : return a != b;
+  }
+}
+
+/* Function operand returns the lattice value of
+ * operand v of an instruction (NO_VREG is the
+ * constant 0 of a branch) and its constant in *c
+ */
+static Lattice operand( int v, int * c )
+{ if (v == NO_VREG)
+  { *c = 0;
+    return CONST;
+  }
+  *c = value[v];
+  return state[v];
+}
+
+/* Procedure visit evaluates instruction in of the
+ * executable block b
+ */
+static void visit( IrInstr * in, IrBlock * b )
+{ Lattice sa, sb, st;
+  int a, c, k;
+  switch (in->op) {
+    case IR_PHI :
+      st = TOP;
+      c = 0;
+      for (k = 0; k < in->imm; k++)
+      { if (!execEdge[b->label][k]) continue;
+        sa = operand(in->args[k],&a);
+        if ((sa == BOTTOM) || ((sa == CONST) && (st == CONST) && (a != c)))
+        { st = BOTTOM;
+          break;
+        }
+        if (sa == CONST)
+        { st = CONST;
+          c = a;
+        }
+      }
+      lower(in->d,st,c);
+      break;
+    case IR_CONST :
+      lower(in->d,CONST,in->imm);
+      break;
+    case IR_COPY :
+      sa = operand(in->a,&a);
+      lower(in->d,sa,a);
+      break;
+    case IR_ADD :
+    case IR_SUB :
+    case IR_MUL :
+    case IR_DIV :
+    case IR_CMP :
+      sa = operand(in->a,&a);
+      sb = operand(in->b,&c);
+      /* x*0 is 0 whatever x is */
+      if ((in->op == IR_MUL) && (((sa == CONST) && (a == 0))
+                                 || ((sb == CONST) && (c == 0))))
+        lower(in->d,CONST,0);
+      else if ((sa == BOTTOM) || (sb == BOTTOM))
+        lower(in->d,BOTTOM,0);
+      else if ((sa == CONST) && (sb == CONST))
+      { /* evaluate as the TM does (+, - and * wrap
+           around, so they are done unsigned, where C
+           defines the overflow), but leave a division by
+           zero to stop the program at run time, and
+           INT_MIN / -1, which would trap in the compiler */
+        switch (in->op) {
+          case IR_ADD :
+            lower(in->d,CONST,(int) ((unsigned) a + (unsigned) c));
+            break;
+          case IR_SUB :
+            lower(in->d,CONST,(int) ((unsigned) a - (unsigned) c));
+            break;
+          case IR_MUL :
+            lower(in->d,CONST,(int) ((unsigned) a * (unsigned) c));
+            break;
+          case IR_DIV :
+            if ((c == 0) || ((c == -1) && (a == INT_MIN)))
+              lower(in->d,BOTTOM,0);
+            else lower(in->d,CONST,a / c);
+            break;
+          default : lower(in->d,CONST,evalRel(in->rel,a,c)); break;
+        }
+      }
+      break;
+    case IR_JUMP :
+      addEdge(b,in->t1);
+      break;
+    case IR_BRANCH :
+      sa = operand(in->a,&a);
+      sb = operand(in->b,&c);
+      if ((sa == BOTTOM) || (sb == BOTTOM))
+      { addEdge(b,in->t1);
+        addEdge(b,in->t2);
+      }
+      else if ((sa == CONST) && (sb == CONST))
+        addEdge(b,evalRel(in->rel,a,c) ? in->t1 : in->t2);
+      break;
+    default :
+      /* loads, input and calls */
+      if (in->d != NO_VREG) lower(in->d,BOTTOM,0);
+      break;
+  }
+}
+
+/* Procedure findUses fills defInstr, defBlock, uses
+ * and useStart
+ */
+static void findUses( IrFunc * f )
+{ IrBlock * b;
+  IrInstr * in;
+  int nv = f->nvregs, v, k, n;
+  int * count = (int *) sccpAlloc(nv + 1,sizeof(int));
+  defInstr = (IrInstr **) sccpAlloc(nv,sizeof(IrInstr *));
+  defBlock = (IrBlock **) sccpAlloc(nv,sizeof(IrBlock *));
+  useStart = (int *) sccpAlloc(nv + 1,sizeof(int));
+  for (b = f->entry; b != NULL; b = b->next)
+    for (in = b->first; in != NULL; in = in->next)
+    { if (in->d != NO_VREG)
+      { defInstr[in->d] = in;
+        defBlock[in->d] = b;
+      }
+      if (in->a != NO_VREG) count[in->a]++;
+      if (in->b != NO_VREG) count[in->b]++;
+      if (in->op == IR_PHI)
+        for (k = 0; k < in->imm; k++) count[in->args[k]]++;
+    }
+  n = 0;
+  for (v = 0; v < nv; v++)
+  { useStart[v] = n;
+    n += count[v];
+    count[v] = useStart[v];
+  }
+  useStart[nv] = n;
+  uses = (USE *) sccpAlloc(n,sizeof(USE));
+#define ADDUSE(v) { uses[count[v]].in = in; uses[count[v]++].blk = b; }
+  for (b = f->entry; b != NULL; b = b->next)
+    for (in = b->first; in != NULL; in = in->next)
+    { if (in->a != NO_VREG) ADDUSE(in->a);
+      if (in->b != NO_VREG) ADDUSE(in->b);
+      if (in->op == IR_PHI)
+        for (k = 0; k < in->imm; k++) ADDUSE(in->args[k]);
+    }
+#undef ADDUSE
+  free(count);
+}
+
+/* Procedure propagate runs the two worklists until
+ * both are empty
+ */
+static void propagate( IrFunc * f )
+{ IrBlock * from, * to;
+  IrInstr * in;
+  EDGE e;
+  int v, k, i, first;
+  addEdge(NULL,f->entry);
+  while ((nflow > 0) || (nssa > 0))
+  { while (nflow > 0)
+    { e = flowWork[--nflow];
+      from = e.from;
+      to = e.to;
+      if (from != NULL)
+      { k = predIndex(to,from);
+        if (execEdge[to->label][k]) continue;
+        execEdge[to->label][k] = TRUE;
+      }
+      first = !execBlock[to->label];
+      execBlock[to->label] = TRUE;
+      /* the phis see a new edge; the rest of the block
+         is evaluated the first time only */
+      for (in = to->first; in != NULL; in = in->next)
+        if (first || (in->op == IR_PHI)) visit(in,to);
+    }
+    while (nssa > 0)
+    { v = ssaWork[--nssa];
+      for (i = useStart[v]; i < useStart[v + 1]; i++)
+        if (execBlock[uses[i].blk->label]) visit(uses[i].in,uses[i].blk);
+    }
+  }
+}
+
+/* Procedure makeConst turns in into d = c */
+static void makeConst( IrInstr * in, int c )
+{ if (in->op == IR_PHI)
+  { free(in->args);
+    in->args = NULL;
+  }
+  in->op = IR_CONST;
+  in->a = in->b = NO_VREG;
+  in->imm = c;
+}
+
+/* Function constUse returns a vreg holding the value
+ * of v for a use by instruction in of block b: a
+ * new constant right before in if v is a constant
+ * defined in another block (keeping the constants
+ * local to the block, for the lowering), else v
+ */
+static int constUse( IrFunc * f, IrBlock * b, IrInstr * in, int v )
+{ IrInstr * c;
+  if ((v == NO_VREG) || (state[v] != CONST) || (defBlock[v] == b)) return v;
+  c = irNewInstr(IR_CONST,ssaNewVreg(f),NO_VREG,NO_VREG,in->lineno);
+  c->imm = value[v];
+  irInsertBefore(b,in,c);
+  return c->d;
+}
+
+/* Procedure rewrite changes f by the results */
+static void rewrite( IrFunc * f, SccpStats * stats )
+{ IrBlock * b, * prev;
+  IrInstr * in, * t;
+  int k, n, live1, live2;
+  /* drop the phi arguments of the edges that are not
+     executable, keeping the order of the others */
+  for (b = f->entry; b != NULL; b = b->next)
+  { if (!execBlock[b->label]) continue;
+    for (in = b->first; (in != NULL) && (in->op == IR_PHI); in = in->next)
+    { n = 0;
+      for (k = 0; k < in->imm; k++)
+        if (execEdge[b->label][k]) in->args[n++] = in->args[k];
+      in->imm = n;
+    }
+  }
+  /* branches that go one way become jumps */
+  for (b = f->entry; b != NULL; b = b->next)
+  { t = b->last;
+    if (!execBlock[b->label] || (t->op != IR_BRANCH)) continue;
+    live1 = execEdge[t->t1->label][predIndex(t->t1,b)];
+    live2 = execEdge[t->t2->label][predIndex(t->t2,b)];
+    if (live1 && live2) continue;
+    t->op = IR_JUMP;
+    if (!live1) t->t1 = t->t2;
+    t->t2 = NULL;
+    t->a = t->b = NO_VREG;
+    stats->branches++;
+  }
+  /* remove the blocks that are never executed */
+  prev = NULL;
+  for (b = f->entry; b != NULL; b = b->next)
+    if (execBlock[b->label])
+    { if (prev != NULL) prev->next = b;
+      prev = b;
+    }
+    else stats->blocks++;
+  prev->next = NULL;
+  irLinkBlocks(f);
+  /* constant definitions become IR_CONST, and the
+     uses of constants from other blocks get their
+     own copy */
+  for (b = f->entry; b != NULL; b = b->next)
+    for (in = b->first; in != NULL; in = in->next)
+    { if ((in->d != NO_VREG) && (state[in->d] == CONST)
+          && (in->op != IR_CONST))
+      { makeConst(in,value[in->d]);
+        stats->consts++;
+      }
+      if (in->op == IR_PHI) continue;
+      in->a = constUse(f,b,in,in->a);
+      if ((in->op == IR_BRANCH) && (in->b != NO_VREG)
+          && (state[in->b] == CONST) && (value[in->b] == 0))
+        in->b = NO_VREG;
+      else in->b = constUse(f,b,in,in->b);
+    }
+}
+
+/* Procedure sccp propagates the constants of f
+ * (in SSA form) and removes the dead blocks
+ */
+void sccp( IrFunc * f, SccpStats * stats )
+{ IrBlock * b;
+  int nv = f->nvregs, v;
+  findUses(f);
+  state = (Lattice *) sccpAlloc(nv,sizeof(Lattice));
+  value = (int *) sccpAlloc(nv,sizeof(int));
+  /* the vregs nothing defines (parameters, and
+     variables used before they are set) are unknown */
+  for (v = 0; v < nv; v++)
+    state[v] = (defInstr[v] == NULL) ? BOTTOM : TOP;
+  execBlock = (char *) sccpAlloc(f->nlabels,1);
+  execEdge = (char **) sccpAlloc(f->nlabels,sizeof(char *));
+  for (b = f->entry; b != NULL; b = b->next)
+    execEdge[b->label] = (char *) sccpAlloc(b->npred,1);
+  propagate(f);
+  rewrite(f,stats);
+  for (v = 0; v < f->nlabels; v++) free(execEdge[v]);
+  free(execEdge);
+  free(execBlock);
+  free(state);
+  free(value);
+  free(defInstr);
+  free(defBlock);
+  free(uses);
+  free(useStart);
+}
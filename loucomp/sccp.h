@@ -0,0 +1,29 @@
+/****************************************************/
+/* File: sccp.h                                     */
+/* Sparse conditional constant propagation on the   */
+/* intermediate representation in SSA form          */
+/****************************************************/
+
+#ifndef _SCCP_H_
+#define _SCCP_H_
+
+#include "ir.h"
+
+/* counts for the TraceOpt report */
+typedef struct
+   { int consts;    /* definitions replaced by constants */
+     int branches;  /* branches turned into jumps */
+     int blocks;    /* blocks removed */
+   } SccpStats;
+
+/* Procedure sccp finds the vregs of f (in SSA form,
+ * see ssa.h) that hold the same constant on every
+ * path that can be executed, and the blocks that
+ * can never be executed (Wegman and Zadeck). Their
+ * definitions become IR_CONST, branches that can
+ * go only one way become jumps and the dead blocks
+ * are removed. The counts are added to stats.
+ */
+void sccp( IrFunc * f, SccpStats * stats );
+
+#endif
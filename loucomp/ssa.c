@@ -0,0 +1,315 @@
+/****************************************************/
+/* File: ssa.c                                      */
+/* Dominators and static single assignment form     */
+/* of the intermediate representation               */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+
+static void ssaOutOfMemory( void )
+{ fprintf(listing,"Out of memory error in SSA construction\n");
+  exit(1);
+}
+
+static void * ssaAlloc( int n, int size )
+{ void * p = calloc(n > 0 ? n : 1,size);
+  if (p == NULL) ssaOutOfMemory();
+  return p;
+}
+
+/**************************************************/
+/***********   Dominators              ************/
+/**************************************************/
+
+/* order holds the blocks in reverse postorder */
+static IrBlock ** order;
+static int norder;
+
+/* Procedure postorder numbers the blocks reachable
+ * from b in postorder, counting down from norder
+ */
+static void postorder( IrBlock * b, char * seen )
+{ seen[b->label] = TRUE;
+  if ((b->last->t2 != NULL) && !seen[b->last->t2->label])
+    postorder(b->last->t2,seen);
+  if ((b->last->t1 != NULL) && !seen[b->last->t1->label])
+    postorder(b->last->t1,seen);
+  b->rpo = --norder;
+  order[b->rpo] = b;
+}
+
+/* Function intersect returns the nearest common
+ * dominator of a and b
+ */
+static IrBlock * intersect( IrBlock * a, IrBlock * b )
+{ while (a != b)
+  { while (a->rpo > b->rpo) a = a->idom;
+    while (b->rpo > a->rpo) b = b->idom;
+  }
+  return a;
+}
+
+/* Procedure irDominators computes the immediate
+ * dominators of the blocks of f, by the iterative
+ * algorithm of Cooper, Harvey and Kennedy
+ */
+void irDominators( IrFunc * f )
+{ IrBlock * b, * d;
+  char * seen = (char *) ssaAlloc(f->nlabels,1);
+  int n = 0, i, k, changed;
+  for (b = f->entry; b != NULL; b = b->next)
+  { b->idom = NULL;
+    n++;
+  }
+  free(order);
+  order = (IrBlock **) ssaAlloc(n,sizeof(IrBlock *));
+  norder = n;
+  postorder(f->entry,seen);
+  free(seen);
+  /* unreachable blocks were removed: norder is 0 */
+  f->entry->idom = f->entry;
+  do
+  { changed = FALSE;
+    for (i = 1; i < n; i++)
+    { b = order[i];
+      d = NULL;
+      for (k = 0; k < b->npred; k++)
+        if (b->pred[k]->idom != NULL)
+          d = (d == NULL) ? b->pred[k] : intersect(b->pred[k],d);
+      if (d != b->idom)
+      { b->idom = d;
+        changed = TRUE;
+      }
+    }
+  } while (changed);
+}
+
+/* Function irDominates tells whether block a
+ * dominates block b
+ */
+int irDominates( IrBlock * a, IrBlock * b )
+{ while ((b != a) && (b->idom != b)) b = b->idom;
+  return b == a;
+}
+
+/**************************************************/
+/***********   SSA construction        ************/
+/**************************************************/
+
+/* the blocks of the dominance frontier of each block,
+   and the children of each block in the dominator
+   tree, indexed by label */
+typedef struct
+   { IrBlock ** block;
+     int n, max;
+   } BLOCKSET;
+
+static BLOCKSET * frontier;
+static BLOCKSET * children;
+
+static void addBlock( BLOCKSET * s, IrBlock * b )
+{ int i;
+  for (i = 0; i < s->n; i++)
+    if (s->block[i] == b) return;
+  if (s->n == s->max)
+  { s->max = s->max == 0 ? 4 : 2 * s->max;
+    s->block = (IrBlock **) realloc(s->block,s->max * sizeof(IrBlock *));
+    if (s->block == NULL) ssaOutOfMemory();
+  }
+  s->block[s->n++] = b;
+}
+
+/* Procedure computeFrontiers computes the dominance
+ * frontiers and the dominator tree
+ */
+static void computeFrontiers( IrFunc * f )
+{ IrBlock * b, * runner;
+  int k;
+  frontier = (BLOCKSET *) ssaAlloc(f->nlabels,sizeof(BLOCKSET));
+  children = (BLOCKSET *) ssaAlloc(f->nlabels,sizeof(BLOCKSET));
+  for (b = f->entry; b != NULL; b = b->next)
+  { if (b != f->entry) addBlock(&children[b->idom->label],b);
+    if (b->npred < 2) continue;
+    for (k = 0; k < b->npred; k++)
+      for (runner = b->pred[k]; runner != b->idom; runner = runner->idom)
+        addBlock(&frontier[runner->label],b);
+  }
+}
+
+static void freeSets( BLOCKSET * s, int n )
+{ int i;
+  for (i = 0; i < n; i++) free(s[i].block);
+  free(s);
+}
+
+/* Procedure placePhis inserts the phi instructions
+ * for every vreg defined in one block and used in
+ * another (the others need none)
+ */
+static void placePhis( IrFunc * f )
+{ IrBlock * b, ** work, * d;
+  IrInstr * in;
+  char * global = (char *) ssaAlloc(f->nvregs,1);
+  char * defined = (char *) ssaAlloc(f->nvregs,1);
+  int * hasPhi = (int *) ssaAlloc(f->nlabels,sizeof(int));
+  int * queued = (int *) ssaAlloc(f->nlabels,sizeof(int));
+  int nwork, v, k, i, nv = f->nvregs;
+  work = (IrBlock **) ssaAlloc(f->nlabels,sizeof(IrBlock *));
+  /* the vregs used in a block before any definition there */
+  for (b = f->entry; b != NULL; b = b->next)
+  { memset(defined,0,nv);
+    for (in = b->first; in != NULL; in = in->next)
+    { if ((in->a != NO_VREG) && !defined[in->a]) global[in->a] = TRUE;
+      if ((in->b != NO_VREG) && !defined[in->b]) global[in->b] = TRUE;
+      if (in->d != NO_VREG) defined[in->d] = TRUE;
+    }
+  }
+  for (i = 0; i < f->nlabels; i++) hasPhi[i] = queued[i] = -1;
+  for (v = 0; v < nv; v++)
+  { if (!global[v]) continue;
+    /* the blocks defining v (the entry defines the
+       parameters) */
+    nwork = 0;
+    for (b = f->entry; b != NULL; b = b->next)
+    { for (in = b->first; in != NULL; in = in->next)
+        if (in->d == v) break;
+      if ((in != NULL) || ((b == f->entry) && (v < f->nparams)))
+      { work[nwork++] = b;
+        queued[b->label] = v;
+      }
+    }
+    while (nwork > 0)
+    { b = work[--nwork];
+      for (k = 0; k < frontier[b->label].n; k++)
+      { d = frontier[b->label].block[k];
+        if (hasPhi[d->label] == v) continue;
+        hasPhi[d->label] = v;
+        in = irNewInstr(IR_PHI,v,NO_VREG,NO_VREG,
+                        d->first == NULL ? 0 : d->first->lineno);
+        in->imm = d->npred;
+        in->args = (int *) ssaAlloc(d->npred,sizeof(int));
+        for (i = 0; i < d->npred; i++) in->args[i] = v;
+        irInsertBefore(d,d->first,in);
+        if (queued[d->label] != v)
+        { queued[d->label] = v;
+          work[nwork++] = d;
+        }
+      }
+    }
+  }
+  free(global);
+  free(defined);
+  free(hasPhi);
+  free(queued);
+  free(work);
+}
+
+/* the current version of each original vreg while
+   renaming: a stack per vreg, linked through prevVersion */
+static int * top;
+static int * prevVersion;
+static int versionSize;  /* allocated size of f->orig and prevVersion */
+
+/* Function newVersion makes a new version of vreg v */
+static int newVersion( IrFunc * f, int v )
+{ int n = irNewVreg(f,f->vregName[v]);
+  /* both arrays grow with the vregs */
+  if (f->maxvregs > versionSize)
+  { versionSize = f->maxvregs;
+    f->orig = (int *) realloc(f->orig,f->maxvregs * sizeof(int));
+    prevVersion = (int *) realloc(prevVersion,f->maxvregs * sizeof(int));
+    if ((f->orig == NULL) || (prevVersion == NULL)) ssaOutOfMemory();
+  }
+  f->orig[n] = v;
+  prevVersion[n] = top[v];
+  top[v] = n;
+  return n;
+}
+
+/* Function ssaNewVreg adds a temporary vreg to f
+ * while it is in SSA form
+ */
+int ssaNewVreg( IrFunc * f )
+{ int n = irNewVreg(f,NULL);
+  if (f->maxvregs > versionSize)
+  { versionSize = f->maxvregs;
+    f->orig = (int *) realloc(f->orig,f->maxvregs * sizeof(int));
+    if (f->orig == NULL) ssaOutOfMemory();
+  }
+  f->orig[n] = n;
+  return n;
+}
+
+/* Procedure renameBlock renames the definitions and uses
+ * in block b and the blocks it dominates
+ */
+static void renameBlock( IrFunc * f, IrBlock * b )
+{ IrInstr * in;
+  IrBlock * s;
+  int k, i, j;
+  for (in = b->first; in != NULL; in = in->next)
+  { if (in->op != IR_PHI)
+    { if (in->a != NO_VREG) in->a = top[in->a];
+      if (in->b != NO_VREG) in->b = top[in->b];
+    }
+    if (in->d != NO_VREG) in->d = newVersion(f,in->d);
+  }
+  /* the phi arguments coming from b */
+  for (k = 0; k < 2; k++)
+  { s = (k == 0) ? b->last->t1 : b->last->t2;
+    if ((s == NULL) || ((k == 1) && (s == b->last->t1))) continue;
+    for (j = 0; s->pred[j] != b; j++) ;
+    for (in = s->first; (in != NULL) && (in->op == IR_PHI); in = in->next)
+      in->args[j] = top[in->args[j]];
+  }
+  for (i = 0; i < children[b->label].n; i++)
+    renameBlock(f,children[b->label].block[i]);
+  /* pop the versions defined here */
+  for (in = b->last; in != NULL; in = in->prev)
+    if (in->d != NO_VREG) top[f->orig[in->d]] = prevVersion[in->d];
+}
+
+/* Procedure ssaBuild puts f into SSA form */
+void ssaBuild( IrFunc * f )
+{ int v, nv = f->nvregs;
+  irDominators(f);
+  computeFrontiers(f);
+  placePhis(f);
+  top = (int *) ssaAlloc(nv,sizeof(int));
+  f->orig = (int *) ssaAlloc(f->maxvregs,sizeof(int));
+  prevVersion = (int *) ssaAlloc(f->maxvregs,sizeof(int));
+  versionSize = f->maxvregs;
+  for (v = 0; v < nv; v++)
+  { top[v] = v;
+    f->orig[v] = v;
+    prevVersion[v] = v;
+  }
+  renameBlock(f,f->entry);
+  free(top);
+  free(prevVersion);
+  freeSets(frontier,f->nlabels);
+  freeSets(children,f->nlabels);
+}
+
+/* Procedure ssaDestroy takes f out of SSA form */
+void ssaDestroy( IrFunc * f )
+{ IrBlock * b;
+  IrInstr * in, * next;
+  for (b = f->entry; b != NULL; b = b->next)
+    for (in = b->first; in != NULL; in = next)
+    { next = in->next;
+      if (in->op == IR_PHI)
+      { irRemove(b,in);
+        free(in->args);
+        free(in);
+        continue;
+      }
+      if (in->d != NO_VREG) in->d = f->orig[in->d];
+      if (in->a != NO_VREG) in->a = f->orig[in->a];
+      if (in->b != NO_VREG) in->b = f->orig[in->b];
+    }
+  free(f->orig);
+  f->orig = NULL;
+}
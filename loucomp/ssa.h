@@ -0,0 +1,52 @@
+/****************************************************/
+/* File: ssa.h                                      */
+/* Dominators and static single assignment form     */
+/* of the intermediate representation               */
+/****************************************************/
+
+#ifndef _SSA_H_
+#define _SSA_H_
+
+#include "ir.h"
+
+/* Procedure irDominators numbers the blocks of f in
+ * reverse postorder (rpo) and computes the immediate
+ * dominator (idom) of each; the entry is its own
+ * immediate dominator. The predecessors must be up
+ * to date (irLinkBlocks).
+ */
+void irDominators( IrFunc * f );
+
+/* Function irDominates tells whether block a
+ * dominates block b
+ */
+int irDominates( IrBlock * a, IrBlock * b );
+
+/* Procedure ssaBuild puts f into SSA form: phi
+ * instructions are placed at the dominance frontiers
+ * of the definitions, and every definition gets a
+ * new vreg (a version of the vreg it defined, which
+ * is recorded in f->orig). A use that no definition
+ * reaches (a parameter, or a variable used before it
+ * is set) keeps the original vreg.
+ */
+void ssaBuild( IrFunc * f );
+
+/* Function ssaNewVreg adds a temporary vreg to f
+ * while it is in SSA form
+ */
+int ssaNewVreg( IrFunc * f );
+
+/* Procedure ssaDestroy takes f out of SSA form by
+ * renaming every version to its original vreg and
+ * removing the phi instructions. This is correct as
+ * long as the passes run in between do not make the
+ * live ranges of two versions of a vreg overlap:
+ * they may replace a definition (a phi too) by a
+ * constant and remove blocks or edges, but may not
+ * move definitions or replace a use of one version
+ * by another.
+ */
+void ssaDestroy( IrFunc * f );
+
+#endif
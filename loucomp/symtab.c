@@ -2,8 +2,8 @@
 /* File: symtab.c                                   */
 /* Symbol table implementation for the TINY compiler*/
 /* (allows only one symbol table)                   */
-/* Symbol table is implemented as a chained         */
-/* hash table                                       */
+/* Symbol table is implemented as an open          */
+/* addressing hash table per scope                  */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
@@ -13,46 +13,98 @@
 #include <string.h>
 #include "globals.h"
 #include "symtab.h"
+#include "intern.h"
 
 
-/* SHIFT is the power of two used as multiplier
-   in hash function  */
-#define SHIFT 4
-#define MAX_SCOPE 1000
+/* INIT_SIZE is the size of the hash table of a
+   scope when its first symbol is inserted */
+#define INIT_SIZE 8
 
-/* the hash function */
-static int hash(char *key)
+/* all the scopes created, and the stack of the
+   open ones; both grow as needed */
+static Scope * scopeExist = NULL;
+static Scope * scopeStack = NULL;
+static int numScope = 0;
+static int numScopeStack = 0;
+static int maxScope = 0;
+static int maxScopeStack = 0;
+
+static void symtabOutOfMemory(void)
 {
-  int temp = 0;
-  int i = 0;
-  while (key[i] != '\0')
-  {
-    temp = ((temp << SHIFT) + key[i]) % SIZE;
-    ++i;
-  }
-  return temp;
+  fprintf(listing, "Out of memory error in symbol table\n");
+  exit(1);
 }
 
-static Scope scopeExist[MAX_SCOPE];
-static Scope scopeStack[MAX_SCOPE];
-static int numScope = 0;
-static int numScopeStack = 0;
+/* Function grow returns list with room for at least
+   n + 1 scopes, doubling *max when needed */
+static Scope *grow(Scope *list, int n, int *max)
+{
+  if (n < *max) return list;
+  *max = (*max == 0) ? 64 : 2 * *max;
+  list = (Scope *)realloc(list, *max * sizeof(Scope));
+  if (list == NULL) symtabOutOfMemory();
+  return list;
+}
+
+/* Function slot returns the index of the slot of
+   name in the table of scope, or of the empty slot
+   where it goes; the table is probed linearly from
+   the (interned) hash of the name */
+static int slot(Scope scope, char *name)
+{
+  int mask = scope->size - 1;
+  int i = internHash(name) & mask;
+  while ((scope->table[i] != NULL) && (scope->table[i]->name != name))
+    i = (i + 1) & mask;
+  return i;
+}
+
+/* Procedure rehash doubles the table of scope (or
+   makes its first one) */
+static void rehash(Scope scope)
+{
+  BucketList *old = scope->table;
+  int oldSize = scope->size, i;
+  scope->size = (oldSize == 0) ? INIT_SIZE : 2 * oldSize;
+  scope->table = (BucketList *)calloc(scope->size, sizeof(BucketList));
+  if (scope->table == NULL) symtabOutOfMemory();
+  for (i = 0; i < oldSize; ++i)
+    if (old[i] != NULL)
+      scope->table[slot(scope, old[i]->name)] = old[i];
+  free(old);
+}
+
+/* Function find returns the symbol name in scope,
+   or NULL */
+static BucketList find(Scope scope, char *name)
+{
+  if (scope->size == 0) return NULL;
+  return scope->table[slot(scope, name)];
+}
 
 Scope scope_create(char *name)
 {
   Scope scope;
   scope = (Scope)malloc(sizeof(struct ScopeListRec));
+  if (scope == NULL) symtabOutOfMemory();
   scope->name = name;
   scope->nestCount = numScopeStack;
   scope->parent = scope_top();
   scope->scopeLoc = 0;
+  /* the table is made by the first insert, so an
+     empty block costs nothing more */
+  scope->table = NULL;
+  scope->size = 0;
+  scope->count = 0;
 
+  scopeExist = grow(scopeExist, numScope, &maxScope);
   scopeExist[numScope++] = scope;
   return scope;
 }
 
 void scope_push(Scope scope)
 {
+  scopeStack = grow(scopeStack, numScopeStack, &maxScopeStack);
   scopeStack[numScopeStack++] = scope;
 }
 
@@ -61,7 +113,7 @@ void scope_pop(int endLine)
   Scope s = scope_top();
   if (endLine != -1)
   {
-    char *newName = (char *)malloc(sizeof(s->name) + 12);
+    char *newName = (char *)malloc(strlen(s->name) + 12);
     sprintf(newName, "%s:%d", s->name, endLine);
     s->name = newName;
   }
@@ -70,20 +122,16 @@ void scope_pop(int endLine)
 
 Scope scope_top()
 {
+  if (numScopeStack == 0) return NULL;
   return scopeStack[numScopeStack - 1];
 }
 
 BucketList st_bucket(char *name)
 {
-  int h = hash(name);
   Scope s = scope_top();
   while (s)
   {
-    BucketList list = s->bucket[h];
-    while ((list != NULL) && (strcmp(name, list->name) != 0))
-    {
-      list = list->next;
-    }
+    BucketList list = find(s, name);
     if (list != NULL)
       return list;
     s = s->parent;
@@ -98,22 +146,23 @@ BucketList st_bucket(char *name)
  */
 void st_insert(char *name, int lineno, TreeNode *treeNode)
 {
-  int h = hash(name);
   Scope top = scope_top();
-  BucketList l = top->bucket[h];
-  while ((l != NULL) && (strcmp(name, l->name) != 0))
-    l = l->next;
+  BucketList l = find(top, name);
   if (l == NULL) /* variable not yet in table */
   {
+    /* keep the table at most three quarters full */
+    if (4 * (top->count + 1) > 3 * top->size)
+      rehash(top);
     l = (BucketList)malloc(sizeof(struct BucketListRec));
+    if (l == NULL) symtabOutOfMemory();
     l->name = name;
     l->treeNode = treeNode;
     l->lines = (LineList)malloc(sizeof(struct LineListRec));
     l->lines->lineno = lineno;
     l->memloc = top->scopeLoc++;
     l->lines->next = NULL;
-    l->next = top->bucket[h];
-    top->bucket[h] = l;
+    top->table[slot(top, name)] = l;
+    top->count++;
   }
 } /* st_insert */
 
@@ -129,18 +178,8 @@ int st_lookup(char *name)
 
 int st_exist_top(char *name)
 {
-  int h = hash(name);
   Scope sc = scope_top();
-  while (sc)
-  {
-    BucketList l = sc->bucket[h];
-    while ((l != NULL) && (strcmp(name, l->name) != 0))
-      l = l->next;
-    if (l != NULL)
-      return TRUE;
-    break;
-  }
-  return FALSE;
+  return (sc != NULL) && (find(sc, name) != NULL);
 }
 
 void st_add_lineno(char *name, int lineno)
@@ -161,11 +200,12 @@ void st_add_lineno(char *name, int lineno)
 void printSymTab(FILE *listing)
 {
   int i, j;
+  BucketList *order = NULL;
+  int maxOrder = 0;
 
   for (i = 0; i < numScope; ++i)
   {
     Scope scope = scopeExist[i];
-    BucketList *bucket = scope->bucket;
     if(scope->scopeLoc != 0){
     char *scopeName = i == 0 ? "" : scope->name;
     fprintf(listing, "Scope name : ~");
@@ -179,42 +219,65 @@ void printSymTab(FILE *listing)
     fprintf(listing, "Variable Name Variable Type  Location   Line Numbers\n");
     fprintf(listing, "------------- -------------  --------   ------------\n");
 
-    for (j = 0; j < SIZE; ++j)
+    /* the symbols are listed in the order of their
+       locations, which is the order they were declared */
+    if (scope->count > maxOrder)
     {
-      if (bucket[j] != NULL)
+      maxOrder = scope->count;
+      order = (BucketList *)realloc(order, maxOrder * sizeof(BucketList));
+      if (order == NULL) symtabOutOfMemory();
+    }
+    for (j = 0; j < scope->size; ++j)
+      if (scope->table[j] != NULL)
+        order[scope->table[j]->memloc] = scope->table[j];
+
+    for (j = 0; j < scope->count; ++j)
+    {
+      BucketList l = order[j];
+      TreeNode *node = l->treeNode;
+      LineList t = l->lines;
+      fprintf(listing, "%-14s", l->name);
+      switch (node->type)
       {
-        BucketList l = bucket[j];
-        TreeNode *node = l->treeNode;
-
-        while (l != NULL)
-        {
-          LineList t = l->lines;
-          fprintf(listing, "%-14s", l->name);
-          switch (node->type)
-          {
-          case Void:
-            fprintf(listing, "Void           ");
-            break;
-          case Integer:
-          case IntegerArray:
-            fprintf(listing, "Integer        ");
-            break;
-          default:
-            break;
-          }
-
-          fprintf(listing, "%-8d ", l->memloc);
-
-          while (t != NULL)
-          {
-            fprintf(listing, "%4d ", t->lineno);
-            t = t->next;
-          }
-          fprintf(listing, "\n");
-          l = l->next;
-        }
+      case Void:
+        fprintf(listing, "Void           ");
+        break;
+      case Integer:
+      case IntegerArray:
+        fprintf(listing, "Integer        ");
+        break;
+      default:
+        break;
       }
+
+      fprintf(listing, "%-8d ", l->memloc);
+
+      while (t != NULL)
+      {
+        fprintf(listing, "%4d ", t->lineno);
+        t = t->next;
+      }
+      fprintf(listing, "\n");
     }
     fprintf(listing, "----------------------------------------------------\n\n");
   }}
+  free(order);
 } /* printSymTab */
+
+/* Procedure printSymStats prints the number of
+ * scopes and symbols and the memory used by their
+ * hash tables to the listing file
+ */
+void printSymStats(FILE *listing)
+{
+  int i, symbols = 0;
+  long bytes = 0;
+  for (i = 0; i < numScope; ++i)
+  {
+    symbols += scopeExist[i]->count;
+    bytes += sizeof(struct ScopeListRec)
+             + scopeExist[i]->size * sizeof(BucketList);
+  }
+  fprintf(listing, "Symbol table: %d scopes, %d symbols, %ld bytes of"
+                   " scope tables\n", numScope, symbols, bytes);
+} /* printSymStats */
@@ -12,9 +12,6 @@
 #include "globals.h"
 
 
-/* SIZE is the size of the hash table */
-#define SIZE 211
-
 /* the list of line numbers of the source 
  * code in which a variable is referenced
  */
@@ -23,7 +20,7 @@ typedef struct LineListRec
      struct LineListRec * next;
    } * LineList;
 
-/* The record in the bucket lists for
+/* The record in the hash table for
  * each variable, including name, 
  * assigned memory location, and
  * the list of line numbers in which
@@ -34,16 +31,21 @@ typedef struct BucketListRec
      LineList lines;
      TreeNode *treeNode;
      int memloc ; /* memory location for variable */
-     struct BucketListRec * next;
    } * BucketList;
 
 /* The record for each scope,
- * including name, its bucket,
- * and parent scope.
+ * including name, its hash table,
+ * and parent scope. The table uses
+ * open addressing; its size is a
+ * power of two (0 until the first
+ * insert) and it is doubled when
+ * three quarters full.
 */
 typedef struct ScopeListRec
    { char * name;
-     BucketList bucket[SIZE];
+     BucketList * table;
+     int size; /* number of slots in table */
+     int count; /* number of symbols in table */
      struct ScopeListRec *parent;
      int nestCount;
      int scopeLoc;
@@ -51,6 +53,11 @@ typedef struct ScopeListRec
 
 
 
+/* The names given to the symbol table functions
+ * must be interned (intern.h): they are compared
+ * by pointer
+ */
+
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
  * loc = memory location is inserted only the
@@ -79,4 +86,10 @@ Scope scope_top();
  */
 void printSymTab(FILE * listing);
 
+/* Procedure printSymStats prints the number of
+ * scopes and symbols and the memory used by their
+ * hash tables to the listing file
+ */
+void printSymStats(FILE * listing);
+
 #endif
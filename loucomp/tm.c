@@ -9,6 +9,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include "tmobj.h"
+
+/* instruction and data memory are mapped anonymously
+ * where available, so that pages are zero-filled by
+ * the system only when first touched
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define   TM_MMAP
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
 
 #ifndef TRUE
 #define TRUE 1
@@ -18,14 +33,41 @@
 #endif
 
 /******* const *******/
-#define   IADDR_SIZE  1024 /* increase for large programs */
-#define   DADDR_SIZE  1024 /* increase for large programs */
+/* default memory sizes; a program may ask for more
+ * with "*!IMEM n" and "*!DMEM n" header lines, and
+ * --imem n / --dmem n override both
+ */
+#define   IADDR_SIZE  1024
+#define   DADDR_SIZE  1024
 #define   NO_REGS 8
 #define   PC_REG  7
 
+/* ZERO_REG is an extra register slot that always
+ * holds 0; the fast engine uses it as the base
+ * register of pc-relative operands folded at
+ * decode time
+ */
+#define   ZERO_REG  NO_REGS
+
 #define   LINESIZE  121
 #define   WORDSIZE  20
 
+/* profile reports list the PROF_TOP most executed
+ * locations, and count data memory accesses per
+ * range of PROF_RANGE words
+ */
+#define   PROF_TOP    20
+#define   PROF_RANGE  16
+
+/* the fast engine uses direct threading (gcc's
+ * labels as values) when the compiler supports it;
+ * define TM_NO_THREADED to force the portable
+ * switch dispatch
+ */
+#if defined(__GNUC__) && !defined(TM_NO_THREADED)
+#define   TM_THREADED
+#endif
+
 /******* type  *******/
 
 typedef enum {
@@ -34,58 +76,123 @@ typedef enum {
    opclRA      /* reg r, int d+s */
    } OPCLASS;
 
-typedef enum {
-   /* RR instructions */
-   opHALT,    /* RR     halt, operands are ignored */
-   opIN,      /* RR     read into reg(r); s and t are ignored */
-   opOUT,     /* RR     write from reg(r), s and t are ignored */
-   opADD,    /* RR     reg(r) = reg(s)+reg(t) */
-   opSUB,    /* RR     reg(r) = reg(s)-reg(t) */
-   opMUL,    /* RR     reg(r) = reg(s)*reg(t) */
-   opDIV,    /* RR     reg(r) = reg(s)/reg(t) */
-   opRRLim,   /* limit of RR opcodes */
-
-   /* RM instructions */
-   opLD,      /* RM     reg(r) = mem(d+reg(s)) */
-   opST,      /* RM     mem(d+reg(s)) = reg(r) */
-   opRMLim,   /* Limit of RM opcodes */
-
-   /* RA instructions */
-   opLDA,     /* RA     reg(r) = d+reg(s) */
-   opLDC,     /* RA     reg(r) = d ; reg(s) is ignored */
-   opJLT,     /* RA     if reg(r)<0 then reg(7) = d+reg(s) */
-   opJLE,     /* RA     if reg(r)<=0 then reg(7) = d+reg(s) */
-   opJGT,     /* RA     if reg(r)>0 then reg(7) = d+reg(s) */
-   opJGE,     /* RA     if reg(r)>=0 then reg(7) = d+reg(s) */
-   opJEQ,     /* RA     if reg(r)==0 then reg(7) = d+reg(s) */
-   opJNE,     /* RA     if reg(r)!=0 then reg(7) = d+reg(s) */
-   opRALim    /* Limit of RA opcodes */
-   } OPCODE;
-
 typedef enum {
    srOKAY,
    srHALT,
    srIMEM_ERR,
    srDMEM_ERR,
-   srZERODIVIDE
+   srZERODIVIDE,
+   srIN_ERR
    } STEPRESULT;
 
+/* operations of the pre-decoded program run by
+ * the fast engine; anything without a fast form
+ * (I/O, HALT, unusual uses of the pc) is executed
+ * through stepTM as xGENERIC
+ */
+typedef enum {
+   xGENERIC,  /* execute iMem[pc] with stepTM */
+   xADD,      /* reg(r) = reg(s)+reg(t) */
+   xSUB,      /* reg(r) = reg(s)-reg(t) */
+   xMUL,      /* reg(r) = reg(s)*reg(t) */
+   xDIV,      /* reg(r) = reg(s)/reg(t) */
+   xLD,       /* reg(r) = mem(d+reg(s)) */
+   xST,       /* mem(d+reg(s)) = reg(r) */
+   xLDA,      /* reg(r) = d+reg(s) */
+   xLDC,      /* reg(r) = d */
+   xJLT,      /* if reg(r)<0 then pc = d+reg(s) */
+   xJLE,      /* if reg(r)<=0 then pc = d+reg(s) */
+   xJGT,      /* if reg(r)>0 then pc = d+reg(s) */
+   xJGE,      /* if reg(r)>=0 then pc = d+reg(s) */
+   xJEQ,      /* if reg(r)==0 then pc = d+reg(s) */
+   xJNE,      /* if reg(r)!=0 then pc = d+reg(s) */
+   xJMP,      /* pc = d+reg(s) (LDA/LDC into pc) */
+   xLDPC      /* pc = mem(d+reg(s)) (LD into pc) */
+   } XOPCODE;
+
 typedef struct {
-      int iop  ;
-      int iarg1  ;
-      int iarg2  ;
-      int iarg3  ;
-   } INSTRUCTION;
+      void * label ; /* handler address when threaded */
+      int xop ;
+      int r, s, t, d ;
+   } XINSTRUCTION;
 
 /******** vars ********/
 int iloc = 0 ;
 int dloc = 0 ;
 int traceflag = FALSE;
 int icountflag = FALSE;
+int fastflag = FALSE;
+int batchflag = FALSE; /* --run: no prompts, plain I/O */
+
+int iaddrSize = IADDR_SIZE;
+int daddrSize = DADDR_SIZE;
+int iaddrFixed = FALSE; /* size given on the command line */
+int daddrFixed = FALSE;
+int iMemTop = 0; /* one past the highest loaded location */
+
+INSTRUCTION * iMem = NULL;
+XINSTRUCTION * xMem = NULL; /* iMemTop+1 decoded entries */
+int xMemThreaded = FALSE; /* labels filled in xMem */
+int * dMem = NULL;
+int reg [NO_REGS+1];
+
+/* source line table of the program (tmobj.h) */
+TMOBJLINE * lineTab = NULL;
+int lineCount = 0;
+int lineTabSize = 0;  /* entries allocated */
+char * nameTab = NULL;
+int nameTabSize = 0;  /* bytes used */
+
+/* functions named in the line table; entryFunc
+ * maps an iMem location to the function entered
+ * there, or -1
+ */
+typedef struct {
+      int name ;   /* offset in nameTab */
+      int entry ;  /* location of the entry point */
+   } FUNCINFO;
+
+FUNCINFO * funcTab = NULL;
+int funcCount = 0;
+int * entryFunc = NULL;
+int * lineFunc = NULL;  /* function of each line table entry */
+
+/* execution profile, kept when profiling is on */
+int profileflag = FALSE;
+char * profileFile = NULL; /* hot-spot report */
+char * profileCsv = NULL;  /* the same counts as CSV */
+unsigned long profTotal = 0;
+unsigned long profOps [opRALim];
+unsigned long * profExec = NULL;   /* per iMem location */
+unsigned long * profTaken = NULL;  /* taken jumps per location */
+unsigned long * profLoads = NULL;  /* per dMem range */
+unsigned long * profStores = NULL;
+
+/* per function counts, plus the calls and inclusive
+ * counts of each caller/callee pair in profEdge, with
+ * index funcCount standing for code outside functions
+ */
+typedef struct {
+      unsigned long calls ;
+      unsigned long inclusive ;
+   } PROFCOUNT;
+
+PROFCOUNT * profFunc = NULL;
+PROFCOUNT * profEdge = NULL;
+int * profDepth = NULL;          /* activations on the stack */
+unsigned long * profStart = NULL; /* profTotal at the outermost */
+
+/* shadow call stack kept while profiling */
+typedef struct {
+      int func ;
+      int caller ;
+      int ret ;                /* return location */
+      unsigned long start ;    /* profTotal at the call */
+   } PROFFRAME;
 
-INSTRUCTION iMem [IADDR_SIZE];
-int dMem [DADDR_SIZE];
-int reg [NO_REGS];
+PROFFRAME * callStack = NULL;
+int callDepth = 0;
+int callStackSize = 0;
 
 char * opCodeTab[]
         = {"HALT","IN","OUT","ADD","SUB","MUL","DIV","????",
@@ -97,10 +204,11 @@ char * opCodeTab[]
 
 char * stepResultTab[]
         = {"OK","Halted","Instruction Memory Fault",
-           "Data Memory Fault","Division by 0"
+           "Data Memory Fault","Division by 0",
+           "Input Error"
           };
 
-char pgmName[20];
+char pgmName[FILENAME_MAX];
 FILE *pgm  ;
 
 char in_Line[LINESIZE] ;
@@ -119,17 +227,43 @@ int opClass( int c )
 } /* opClass */
 
 /********************************************/
-void writeInstruction ( int loc )
-{ printf( "%5d: ", loc) ;
-  if ( (loc >= 0) && (loc < IADDR_SIZE) )
-  { printf("%6s%3d,", opCodeTab[iMem[loc].iop], iMem[loc].iarg1);
-    switch ( opClass(iMem[loc].iop) )
-    { case opclRR: printf("%1d,%1d", iMem[loc].iarg2, iMem[loc].iarg3);
-                   break;
-      case opclRM:
-      case opclRA: printf("%3d(%1d)", iMem[loc].iarg2, iMem[loc].iarg3);
-                   break;
+/* lineEntry returns the index of the line table
+ * entry covering loc, or -1 if there is none
+ */
+int lineEntry ( int loc )
+{ int lo = 0, hi = lineCount - 1, mid, found = -1;
+  while (lo <= hi)
+  { mid = (lo + hi) / 2;
+    if (lineTab[mid].loc <= loc)
+    { found = mid;
+      lo = mid + 1;
     }
+    else hi = mid - 1;
+  }
+  return found;
+} /* lineEntry */
+
+/********************************************/
+/* printInstruction prints iMem[loc] in TM syntax */
+void printInstruction ( FILE * f, int loc )
+{ fprintf(f, "%6s%3d,", opCodeTab[iMem[loc].iop], iMem[loc].iarg1);
+  switch ( opClass(iMem[loc].iop) )
+  { case opclRR: fprintf(f, "%1d,%1d", iMem[loc].iarg2, iMem[loc].iarg3);
+                 break;
+    case opclRM:
+    case opclRA: fprintf(f, "%3d(%1d)", iMem[loc].iarg2, iMem[loc].iarg3);
+                 break;
+  }
+} /* printInstruction */
+
+/********************************************/
+void writeInstruction ( int loc )
+{ int e;
+  printf( "%5d: ", loc) ;
+  if ( (loc >= 0) && (loc < iaddrSize) )
+  { printInstruction(stdout, loc);
+    if ( ((e = lineEntry(loc)) >= 0) && (lineTab[e].line > 0) )
+      printf("\t(line %d)", lineTab[e].line);
     printf ("\n") ;
   }
 } /* writeInstruction */
@@ -211,12 +345,160 @@ int atEOL(void)
 
 /********************************************/
 int error( char * msg, int lineNo, int instNo)
-{ printf("Line %d",lineNo);
+{ if (lineNo > 0) printf("Line %d",lineNo);
+  else printf("%s",pgmName);
   if (instNo >= 0) printf(" (Instruction %d)",instNo);
   printf("   %s\n",msg);
   return FALSE;
 } /* error */
 
+/********************************************/
+/* allocZeroed returns n bytes of zero-filled
+ * memory, or NULL if there is not enough
+ */
+void * allocZeroed ( size_t n )
+{
+#ifdef TM_MMAP
+  void * p = mmap(NULL, n, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+#else
+  return calloc(n, 1);
+#endif
+} /* allocZeroed */
+
+/********************************************/
+void freeZeroed ( void * p, size_t n )
+{ if (p == NULL) return;
+#ifdef TM_MMAP
+  munmap(p, n);
+#else
+  free(p);
+#endif
+} /* freeZeroed */
+
+/********************************************/
+/* clearData replaces dMem by fresh zeroed memory,
+ * with dMem[0] holding the highest data address
+ */
+int clearData (void)
+{ freeZeroed(dMem, (size_t) daddrSize * sizeof(int));
+  dMem = (int *) allocZeroed((size_t) daddrSize * sizeof(int));
+  if (dMem == NULL) return FALSE;
+  dMem[0] = daddrSize - 1 ;
+  return TRUE;
+} /* clearData */
+
+/********************************************/
+/* allocMemory allocates iMem and dMem once their
+ * sizes are known; zeroed iMem reads as HALT 0,0,0
+ */
+int allocMemory (void)
+{ iMem = (INSTRUCTION *)
+         allocZeroed((size_t) iaddrSize * sizeof(INSTRUCTION));
+  if (iMem == NULL) return FALSE;
+  return clearData();
+} /* allocMemory */
+
+/********************************************/
+/* getSize converts a memory size argument with an
+ * optional K or M suffix; it returns 0 if invalid
+ */
+int getSize ( char * arg )
+{ char * end;
+  long n = strtol(arg, &end, 10);
+  long unit = 1;
+  if ((*end == 'K') || (*end == 'k')) { unit = 1024L; end++; }
+  else if ((*end == 'M') || (*end == 'm')) { unit = 1024L*1024L; end++; }
+  if ((*end != '\0') || (n <= 0) || (n > INT_MAX / unit))
+    return 0;
+  return (int) (n * unit);
+} /* getSize */
+
+/********************************************/
+/* readDirective handles a "*!IMEM n" or "*!DMEM n"
+ * header line (n may end in K or M); sizes given
+ * on the command line win
+ */
+int readDirective ( int lineNo )
+{ int * size;
+  int fixed;
+  inCol += 2 ;
+  if (! getWord ())
+    return error("Missing directive", lineNo,-1);
+  if (strcmp(word, "IMEM") == 0)
+  { size = &iaddrSize ;
+    fixed = iaddrFixed ;
+  }
+  else if (strcmp(word, "DMEM") == 0)
+  { size = &daddrSize ;
+    fixed = daddrFixed ;
+  }
+  else
+    return error("Unknown directive", lineNo,-1);
+  if (iMem != NULL)
+    return error("Directive after first instruction", lineNo,-1);
+  if ( (! getWord ()) || ((num = getSize(word)) == 0) || (! atEOL ()) )
+    return error("Bad memory size", lineNo,-1);
+  if (! fixed) *size = num ;
+  return TRUE;
+} /* readDirective */
+
+/********************************************/
+/* addName returns the offset of name in nameTab,
+ * adding it if it is new, or -1 if out of memory
+ */
+int addName ( char * name )
+{ int n = 0;
+  while ( (n < nameTabSize) && (strcmp(nameTab + n, name) != 0) )
+    n += strlen(nameTab + n) + 1 ;
+  if (n == nameTabSize)
+  { char * p = (char *) realloc(nameTab, nameTabSize + strlen(name) + 1);
+    if (p == NULL) return -1 ;
+    nameTab = p ;
+    strcpy(nameTab + n, name);
+    nameTabSize += strlen(name) + 1 ;
+  }
+  return n ;
+} /* addName */
+
+/********************************************/
+/* readLineEntry handles a "*@ loc line name" line
+ * table entry; entries come in increasing loc
+ * order and the name is optional
+ */
+int readLineEntry ( int lineNo )
+{ TMOBJLINE e;
+  int start;
+  inCol += 2 ;
+  if ( (! getNum ()) || (num < 0) )
+    return error("Bad line table location", lineNo,-1);
+  e.loc = num ;
+  if ( (lineCount > 0) && (e.loc <= lineTab[lineCount-1].loc) )
+    return error("Line table out of order", lineNo,e.loc);
+  if (! getNum ())
+    return error("Bad line table line", lineNo,e.loc);
+  e.line = num ;
+  e.name = -1 ;
+  if (nonBlank ())
+  { start = inCol ;
+    while ( (inCol < lineLen) && (in_Line[inCol] != ' ') ) inCol++ ;
+    in_Line[inCol] = '\0' ;
+    if ((e.name = addName(in_Line + start)) < 0)
+      return error("Out of memory", lineNo,-1);
+  }
+  if (lineCount == lineTabSize)
+  { TMOBJLINE * p;
+    lineTabSize = lineTabSize == 0 ? 64 : 2 * lineTabSize ;
+    p = (TMOBJLINE *) realloc(lineTab, lineTabSize * sizeof(TMOBJLINE));
+    if (p == NULL)
+      return error("Out of memory", lineNo,-1);
+    lineTab = p ;
+  }
+  lineTab[lineCount++] = e ;
+  return TRUE;
+} /* readLineEntry */
+
 /********************************************/
 int readInstructions (void)
 { OPCODE op;
@@ -224,28 +506,35 @@ int readInstructions (void)
   int loc, regNo, lineNo;
   for (regNo = 0 ; regNo < NO_REGS ; regNo++)
       reg[regNo] = 0 ;
-  dMem[0] = DADDR_SIZE - 1 ;
-  for (loc = 1 ; loc < DADDR_SIZE ; loc++)
-      dMem[loc] = 0 ;
-  for (loc = 0 ; loc < IADDR_SIZE ; loc++)
-  { iMem[loc].iop = opHALT ;
-    iMem[loc].iarg1 = 0 ;
-    iMem[loc].iarg2 = 0 ;
-    iMem[loc].iarg3 = 0 ;
-  }
   lineNo = 0 ;
   while (! feof(pgm))
-  { fgets( in_Line, LINESIZE-2, pgm  ) ;
+  { if (fgets( in_Line, LINESIZE-2, pgm  ) == NULL) break ;
     inCol = 0 ; 
     lineNo++;
     lineLen = strlen(in_Line)-1 ;
     if (in_Line[lineLen]=='\n') in_Line[lineLen] = '\0' ;
     else in_Line[++lineLen] = '\0';
-    if ( (nonBlank()) && (in_Line[inCol] != '*') )
-    { if (! getNum())
+    if ( (lineLen > 0) && (in_Line[lineLen-1] == '\r') )
+      in_Line[--lineLen] = '\0';
+    if ( (nonBlank()) && (in_Line[inCol] == '*')
+         && (in_Line[inCol+1] == '!') )
+    { if (! readDirective (lineNo))
+        return FALSE;
+    }
+    else if ( (nonBlank()) && (in_Line[inCol] == '*')
+              && (in_Line[inCol+1] == '@') )
+    { if (! readLineEntry (lineNo))
+        return FALSE;
+    }
+    else if ( (nonBlank()) && (in_Line[inCol] != '*') )
+    { if ( (iMem == NULL) && (! allocMemory ()) )
+        return error("Out of memory", lineNo,-1);
+      if (! getNum())
         return error("Bad location", lineNo,-1);
       loc = num;
-      if (loc > IADDR_SIZE)
+      if (loc < 0)
+        return error("Bad location", lineNo,loc);
+      if (loc >= iaddrSize)
         return error("Location too large",lineNo,loc);
       if (! skipCh(':'))
         return error("Missing colon", lineNo,loc);
@@ -297,11 +586,108 @@ int readInstructions (void)
       iMem[loc].iarg1 = arg1;
       iMem[loc].iarg2 = arg2;
       iMem[loc].iarg3 = arg3;
+      if (loc >= iMemTop) iMemTop = loc + 1 ;
     }
   }
+  if ( (iMem == NULL) && (! allocMemory ()) )
+    return error("Out of memory", lineNo,-1);
   return TRUE;
 } /* readInstructions */
 
+/********************************************/
+/* isObject tells whether pgm holds a binary
+ * image rather than program text
+ */
+int isObject (void)
+{ int magic = 0;
+  int temp;
+  temp = (fread(&magic, sizeof(int), 1, pgm) == 1)
+         && (magic == TMOBJ_MAGIC);
+  rewind(pgm);
+  return temp;
+} /* isObject */
+
+/********************************************/
+/* loadObject loads a binary image; the code is
+ * mapped from the file in place when it is page
+ * aligned, and only checked, never parsed
+ */
+int loadObject (void)
+{ TMOBJHEADER h;
+  long fileSize;
+  int loc, regNo, mapped = FALSE;
+  INSTRUCTION * i;
+  for (regNo = 0 ; regNo < NO_REGS ; regNo++)
+      reg[regNo] = 0 ;
+  fseek(pgm, 0L, SEEK_END);
+  fileSize = ftell(pgm);
+  rewind(pgm);
+  if ( (fread(&h, sizeof(h), 1, pgm) != 1)
+       || (h.magic != TMOBJ_MAGIC) )
+    return error("Bad object header", 0,-1);
+  if (h.version != TMOBJ_VERSION)
+    return error("Unsupported object version", 0,-1);
+  if ( (h.codeCount < 0) || (h.lineCount < 0) || (h.nameSize < 0)
+       || (h.codeOffset < 0) || (h.lineOffset < 0) || (h.nameOffset < 0)
+       || (h.codeOffset + (long) h.codeCount * sizeof(INSTRUCTION) > fileSize)
+       || (h.lineOffset + (long) h.lineCount * sizeof(TMOBJLINE) > fileSize)
+       || (h.nameOffset + (long) h.nameSize > fileSize) )
+    return error("Truncated object file", 0,-1);
+  if ( (! iaddrFixed) && (h.imemSize > 0) ) iaddrSize = h.imemSize ;
+  if ( (! daddrFixed) && (h.dmemSize > 0) ) daddrSize = h.dmemSize ;
+  if ( (! iaddrFixed) && (h.codeCount > iaddrSize) ) iaddrSize = h.codeCount ;
+  if (h.codeCount > iaddrSize)
+    return error("Location too large", 0,h.codeCount-1);
+  if (! allocMemory ())
+    return error("Out of memory", 0,-1);
+#ifdef TM_MMAP
+  if ( (h.codeCount > 0) && (h.codeOffset % sysconf(_SC_PAGESIZE) == 0) )
+    mapped = mmap(iMem, (size_t) h.codeCount * sizeof(INSTRUCTION),
+                  PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                  fileno(pgm), h.codeOffset) != MAP_FAILED;
+#endif
+  if ( (! mapped)
+       && ( (fseek(pgm, h.codeOffset, SEEK_SET) != 0)
+            || (fread(iMem, sizeof(INSTRUCTION), h.codeCount, pgm)
+                != (size_t) h.codeCount) ) )
+    return error("Cannot read object code", 0,-1);
+  for (loc = 0 ; loc < h.codeCount ; loc++)
+  { i = &iMem[loc] ;
+    if ( (i->iop < 0) || (i->iop >= opRALim)
+         || (i->iop == opRRLim) || (i->iop == opRMLim) )
+      return error("Illegal opcode", 0,loc);
+    if ( (i->iarg1 < 0) || (i->iarg1 >= NO_REGS)
+         || (i->iarg3 < 0) || (i->iarg3 >= NO_REGS)
+         || ( (opClass(i->iop) == opclRR)
+              && ((i->iarg2 < 0) || (i->iarg2 >= NO_REGS)) ) )
+      return error("Bad register", 0,loc);
+  }
+  iMemTop = h.codeCount ;
+  if (h.lineCount > 0)
+  { lineTab = (TMOBJLINE *) malloc(h.lineCount * sizeof(TMOBJLINE));
+    nameTab = (char *) malloc(h.nameSize + 1);
+    if ( (lineTab == NULL) || (nameTab == NULL) )
+      return error("Out of memory", 0,-1);
+    fseek(pgm, h.lineOffset, SEEK_SET);
+    if (fread(lineTab, sizeof(TMOBJLINE), h.lineCount, pgm)
+        != (size_t) h.lineCount)
+      return error("Cannot read line table", 0,-1);
+    fseek(pgm, h.nameOffset, SEEK_SET);
+    if (fread(nameTab, 1, h.nameSize, pgm) != (size_t) h.nameSize)
+      return error("Cannot read line table", 0,-1);
+    nameTab[h.nameSize] = '\0';
+    lineCount = h.lineCount ;
+    nameTabSize = h.nameSize ;
+    for (loc = 0 ; loc < lineCount ; loc++)
+    { if ( (loc > 0) && (lineTab[loc].loc <= lineTab[loc-1].loc) )
+        return error("Line table out of order", 0,-1);
+      if ( (lineTab[loc].name < -1) || (lineTab[loc].name >= h.nameSize) )
+        lineTab[loc].name = -1 ;
+    }
+  }
+  return TRUE;
+} /* loadObject */
+
 
 /********************************************/
 STEPRESULT stepTM (void)
@@ -311,7 +697,7 @@ STEPRESULT stepTM (void)
   int ok ;
 
   pc = reg[PC_REG] ;
-  if ( (pc < 0) || (pc > IADDR_SIZE)  )
+  if ( (pc < 0) || (pc >= iaddrSize)  )
       return srIMEM_ERR ;
   reg[PC_REG] = pc + 1 ;
   currentinstruction = iMem[ pc ] ;
@@ -328,7 +714,7 @@ STEPRESULT stepTM (void)
       r = currentinstruction.iarg1 ;
       s = currentinstruction.iarg3 ;
       m = currentinstruction.iarg2 + reg[s] ;
-      if ( (m < 0) || (m > DADDR_SIZE))
+      if ( (m < 0) || (m >= daddrSize))
          return srDMEM_ERR ;
       break;
 
@@ -344,12 +730,17 @@ STEPRESULT stepTM (void)
   { /* RR instructions */
     case opHALT :
     /***********************************/
-      printf("HALT: %1d,%1d,%1d\n",r,s,t);
+      if ( ! batchflag ) printf("HALT: %1d,%1d,%1d\n",r,s,t);
       return srHALT ;
       /* break; */
 
     case opIN :
     /***********************************/
+      if ( batchflag )
+      { if ( scanf("%d", &num) != 1 ) return srIN_ERR ;
+        reg[r] = num;
+        break;
+      }
       do
       { printf("Enter value for IN instruction: ") ;
         fflush (stdin);
@@ -365,7 +756,8 @@ STEPRESULT stepTM (void)
       break;
 
     case opOUT :  
-      printf ("OUT instruction prints: %d\n", reg[r] ) ;
+      if ( batchflag ) printf ("%d\n", reg[r] ) ;
+      else printf ("OUT instruction prints: %d\n", reg[r] ) ;
       break;
     case opADD :  reg[r] = reg[s] + reg[t] ;  break;
     case opSUB :  reg[r] = reg[s] - reg[t] ;  break;
@@ -396,13 +788,591 @@ STEPRESULT stepTM (void)
   return srOKAY ;
 } /* stepTM */
 
+/********************************************/
+/* decodeInstructions translates iMem up to iMemTop
+ * into the form run by runTM: pc-relative operands
+ * are folded into absolute displacements (reg(7)
+ * is always loc+1 while loc executes) and writes
+ * to the pc become jumps
+ */
+int decodeInstructions (void)
+{ int loc;
+  INSTRUCTION * i;
+  XINSTRUCTION * x;
+  free(xMem);
+  xMem = (XINSTRUCTION *) malloc((iMemTop + 1) * sizeof(XINSTRUCTION));
+  if (xMem == NULL) return FALSE;
+  for (loc = 0 ; loc < iMemTop ; loc++)
+  { i = &iMem[loc] ;
+    x = &xMem[loc] ;
+    x->xop = xGENERIC ;
+    x->r = i->iarg1 ;
+    switch ( opClass(i->iop) )
+    { case opclRR :
+      /***********************************/
+        x->s = i->iarg2 ;
+        x->t = i->iarg3 ;
+        x->d = 0 ;
+        if ( (x->r == PC_REG) || (x->s == PC_REG) || (x->t == PC_REG) )
+          break;
+        switch ( i->iop )
+        { case opADD : x->xop = xADD ; break;
+          case opSUB : x->xop = xSUB ; break;
+          case opMUL : x->xop = xMUL ; break;
+          case opDIV : x->xop = xDIV ; break;
+          default : break; /* HALT, IN, OUT */
+        }
+        break;
+
+      case opclRM :
+      case opclRA :
+      /***********************************/
+        x->s = i->iarg3 ;
+        x->t = 0 ;
+        x->d = i->iarg2 ;
+        if ( x->s == PC_REG )
+        { x->s = ZERO_REG ;
+          x->d += loc + 1 ;
+        }
+        if ( i->iop == opLDC )
+        { x->s = ZERO_REG ;
+          x->d = i->iarg2 ;
+        }
+        if ( x->r == PC_REG )
+        { switch ( i->iop )
+          { case opLD :  x->xop = xLDPC ; break;
+            case opLDA :
+            case opLDC : x->xop = xJMP ; break;
+            default : break; /* stores or tests the pc */
+          }
+          break;
+        }
+        switch ( i->iop )
+        { case opLD :  x->xop = xLD ;  break;
+          case opST :  x->xop = xST ;  break;
+          case opLDA : x->xop = xLDA ; break;
+          case opLDC : x->xop = xLDC ; break;
+          case opJLT : x->xop = xJLT ; break;
+          case opJLE : x->xop = xJLE ; break;
+          case opJGT : x->xop = xJGT ; break;
+          case opJGE : x->xop = xJGE ; break;
+          case opJEQ : x->xop = xJEQ ; break;
+          case opJNE : x->xop = xJNE ; break;
+          default : break;
+        }
+        break;
+    }
+  }
+  /* whatever lies beyond is HALT or a fault: stepTM decides */
+  xMem[iMemTop].xop = xGENERIC ;
+  xMemThreaded = FALSE ;
+  return TRUE;
+} /* decodeInstructions */
+
+/********************************************/
+/* runTM executes the decoded program from the
+ * current pc until a step result other than
+ * srOKAY, with the same effect on reg, dMem and
+ * the step count as repeated calls of stepTM;
+ * the number of steps is returned in *count
+ */
+STEPRESULT runTM (int * count)
+{ XINSTRUCTION * x;
+  int * r = reg;
+  int * m = dMem;
+  int top = iMemTop;
+  int dsize = daddrSize;
+  int n = 0;
+  int a;
+  STEPRESULT result;
+#ifdef TM_THREADED
+  static void * labelTab[] =
+        { &&L_xGENERIC, &&L_xADD, &&L_xSUB, &&L_xMUL, &&L_xDIV,
+          &&L_xLD, &&L_xST, &&L_xLDA, &&L_xLDC,
+          &&L_xJLT, &&L_xJLE, &&L_xJGT, &&L_xJGE, &&L_xJEQ, &&L_xJNE,
+          &&L_xJMP, &&L_xLDPC
+        };
+#define OP(op)      L_##op:
+#define DISPATCH    goto *x->label
+#else
+#define OP(op)      case op:
+#define DISPATCH    goto dispatch
+#endif
+/* fall through to the next instruction */
+#define NEXT        { x++ ; n++ ; DISPATCH ; }
+/* transfer control to absolute address t */
+#define JUMP(t)     { a = (t) ; \
+                      if ( (a < 0) || (a >= top) ) goto farJump ; \
+                      x = xMem + a ; n++ ; DISPATCH ; }
+/* data address of an RM operand, checked */
+#define DADDR       a = x->d + r[x->s] ; \
+                    if ( (a < 0) || (a >= dsize) ) \
+                    { result = srDMEM_ERR ; goto fault ; }
+
+#ifdef TM_THREADED
+  if ( ! xMemThreaded )
+  { for (a = 0 ; a <= top ; a++)
+      xMem[a].label = labelTab[xMem[a].xop] ;
+    xMemThreaded = TRUE ;
+  }
+#endif
+  reg[ZERO_REG] = 0 ;
+  JUMP(reg[PC_REG]) ;
+
+#ifndef TM_THREADED
+dispatch:
+  switch ( x->xop )
+  {
+#endif
+  OP(xADD)   r[x->r] = r[x->s] + r[x->t] ;  NEXT
+  OP(xSUB)   r[x->r] = r[x->s] - r[x->t] ;  NEXT
+  OP(xMUL)   r[x->r] = r[x->s] * r[x->t] ;  NEXT
+  OP(xDIV)   if ( r[x->t] == 0 )
+             { result = srZERODIVIDE ; goto fault ; }
+             r[x->r] = r[x->s] / r[x->t] ;  NEXT
+  OP(xLD)    DADDR  r[x->r] = m[a] ;  NEXT
+  OP(xST)    DADDR  m[a] = r[x->r] ;  NEXT
+  OP(xLDA)   r[x->r] = x->d + r[x->s] ;  NEXT
+  OP(xLDC)   r[x->r] = x->d ;  NEXT
+  OP(xJLT)   if ( r[x->r] <  0 ) JUMP(x->d + r[x->s]) ;  NEXT
+  OP(xJLE)   if ( r[x->r] <= 0 ) JUMP(x->d + r[x->s]) ;  NEXT
+  OP(xJGT)   if ( r[x->r] >  0 ) JUMP(x->d + r[x->s]) ;  NEXT
+  OP(xJGE)   if ( r[x->r] >= 0 ) JUMP(x->d + r[x->s]) ;  NEXT
+  OP(xJEQ)   if ( r[x->r] == 0 ) JUMP(x->d + r[x->s]) ;  NEXT
+  OP(xJNE)   if ( r[x->r] != 0 ) JUMP(x->d + r[x->s]) ;  NEXT
+  OP(xJMP)   JUMP(x->d + r[x->s]) ;
+  OP(xLDPC)  DADDR  JUMP(m[a]) ;
+  OP(xGENERIC)
+    reg[PC_REG] = x - xMem ;
+    result = stepTM () ;
+    if ( result != srOKAY ) goto done ;
+    JUMP(reg[PC_REG]) ;
+#ifndef TM_THREADED
+  }
+#endif
+
+farJump:
+  /* outside the decoded program: stepTM faults or halts */
+  n++ ;
+  reg[PC_REG] = a ;
+  result = stepTM () ;
+  if ( result == srOKAY ) JUMP(reg[PC_REG]) ;
+  goto done ;
+fault:
+  /* stepTM has advanced the pc before the fault */
+  reg[PC_REG] = (x - xMem) + 1 ;
+done:
+  *count = n ;
+  return result ;
+#undef OP
+#undef DISPATCH
+#undef NEXT
+#undef JUMP
+#undef DADDR
+} /* runTM */
+
+/********************************************/
+/* buildFunctions fills funcTab, entryFunc and
+ * lineFunc from the names in the line table
+ */
+int buildFunctions (void)
+{ int e, f, loc;
+  funcTab = (FUNCINFO *) malloc((lineCount + 1) * sizeof(FUNCINFO));
+  lineFunc = (int *) malloc((lineCount + 1) * sizeof(int));
+  entryFunc = (int *) malloc(iaddrSize * sizeof(int));
+  if ( (funcTab == NULL) || (lineFunc == NULL) || (entryFunc == NULL) )
+    return FALSE;
+  for (loc = 0 ; loc < iaddrSize ; loc++) entryFunc[loc] = -1 ;
+  funcCount = 0;
+  for (e = 0 ; e < lineCount ; e++)
+  { lineFunc[e] = -1 ;
+    if (lineTab[e].name < 0) continue;
+    for (f = 0 ; f < funcCount ; f++)
+      if (funcTab[f].name == lineTab[e].name) break;
+    if (f == funcCount)
+    { funcTab[f].name = lineTab[e].name ;
+      funcTab[f].entry = lineTab[e].loc ;
+      if (lineTab[e].loc < iaddrSize) entryFunc[lineTab[e].loc] = f ;
+      funcCount++ ;
+    }
+    lineFunc[e] = f ;
+  }
+  return TRUE;
+} /* buildFunctions */
+
+/********************************************/
+/* funcOf returns the function loc belongs to,
+ * or funcCount for code outside functions
+ */
+int funcOf ( int loc )
+{ int e = lineEntry(loc);
+  return ( (e < 0) || (lineFunc[e] < 0) ) ? funcCount : lineFunc[e] ;
+} /* funcOf */
+
+/********************************************/
+/* initProfile allocates the profile counters
+ * once the memory sizes are known
+ */
+int initProfile (void)
+{ int ranges = (daddrSize + PROF_RANGE - 1) / PROF_RANGE;
+  int n;
+  if (! buildFunctions ()) return FALSE;
+  n = funcCount + 1;
+  profFunc = (PROFCOUNT *) calloc(n, sizeof(PROFCOUNT));
+  profEdge = (PROFCOUNT *) calloc(n * n, sizeof(PROFCOUNT));
+  profDepth = (int *) calloc(n, sizeof(int));
+  profStart = (unsigned long *) calloc(n, sizeof(unsigned long));
+  if ( (profFunc == NULL) || (profEdge == NULL)
+       || (profDepth == NULL) || (profStart == NULL) )
+    return FALSE;
+  profExec = (unsigned long *)
+             allocZeroed((size_t) iaddrSize * sizeof(unsigned long));
+  profTaken = (unsigned long *)
+              allocZeroed((size_t) iaddrSize * sizeof(unsigned long));
+  profLoads = (unsigned long *)
+              allocZeroed((size_t) ranges * sizeof(unsigned long));
+  profStores = (unsigned long *)
+               allocZeroed((size_t) ranges * sizeof(unsigned long));
+  return (profExec != NULL) && (profTaken != NULL)
+         && (profLoads != NULL) && (profStores != NULL);
+} /* initProfile */
+
+/********************************************/
+/* profCall pushes a call of f from caller that
+ * returns to location ret on the shadow stack
+ */
+void profCall ( int f, int caller, int ret )
+{ PROFFRAME * fr;
+  if (callDepth == callStackSize)
+  { int n = callStackSize == 0 ? 64 : 2 * callStackSize ;
+    fr = (PROFFRAME *) realloc(callStack, n * sizeof(PROFFRAME));
+    if (fr == NULL) return; /* stop following calls */
+    callStack = fr ;
+    callStackSize = n ;
+  }
+  fr = &callStack[callDepth++] ;
+  fr->func = f ;
+  fr->caller = caller ;
+  fr->ret = ret ;
+  fr->start = profTotal ;
+  profFunc[f].calls++ ;
+  profEdge[caller * (funcCount + 1) + f].calls++ ;
+  if (profDepth[f]++ == 0) profStart[f] = profTotal ;
+} /* profCall */
+
+/********************************************/
+/* profReturn pops the innermost call, charging
+ * the instructions executed since it to the call
+ * (and to the function, unless it is recursive)
+ */
+void profReturn (void)
+{ PROFFRAME * fr = &callStack[--callDepth] ;
+  profEdge[fr->caller * (funcCount + 1) + fr->func].inclusive
+    += profTotal - fr->start ;
+  if (--profDepth[fr->func] == 0)
+    profFunc[fr->func].inclusive += profTotal - profStart[fr->func] ;
+} /* profReturn */
+
+/********************************************/
+/* profileStep performs stepTM and counts the
+ * instruction, whether a jump was taken, and
+ * the data range a load or store touched
+ */
+STEPRESULT profileStep (void)
+{ int pc = reg[PC_REG] ;
+  INSTRUCTION * i;
+  int r = 0, m = -1, taken = FALSE;
+  STEPRESULT result;
+  if ( (pc < 0) || (pc >= iaddrSize) )
+    return stepTM () ;
+  i = &iMem[pc] ;
+  /* operands decoded as in stepTM, with reg(7) = pc+1;
+     only RM instructions address data memory */
+  switch ( opClass(i->iop) )
+  { case opclRR :
+      break;
+    case opclRM :
+      m = i->iarg2 + ((i->iarg3 == PC_REG) ? pc + 1 : reg[i->iarg3]) ;
+      break;
+    case opclRA :
+      r = (i->iarg1 == PC_REG) ? pc + 1 : reg[i->iarg1] ;
+      break;
+  }
+  switch ( i->iop )
+  { case opJLT : taken = r <  0 ; break;
+    case opJLE : taken = r <= 0 ; break;
+    case opJGT : taken = r >  0 ; break;
+    case opJGE : taken = r >= 0 ; break;
+    case opJEQ : taken = r == 0 ; break;
+    case opJNE : taken = r != 0 ; break;
+    default : break;
+  }
+  result = stepTM () ;
+  profTotal++ ;
+  profExec[pc]++ ;
+  profOps[i->iop]++ ;
+  if ( taken ) profTaken[pc]++ ;
+  if ( (result == srOKAY) && (m >= 0) )
+  { if ( i->iop == opLD ) profLoads[m / PROF_RANGE]++ ;
+    else profStores[m / PROF_RANGE]++ ;
+  }
+  if ( (result == srOKAY) && (funcCount > 0)
+       && (reg[PC_REG] != pc + 1) )
+  { if ( (callDepth > 0) && (reg[PC_REG] == callStack[callDepth-1].ret) )
+      profReturn () ;
+    else if ( (reg[PC_REG] >= 0) && (reg[PC_REG] < iaddrSize)
+              && (entryFunc[reg[PC_REG]] >= 0) )
+      profCall (entryFunc[reg[PC_REG]], funcOf(pc), pc + 1) ;
+  }
+  return result ;
+} /* profileStep */
+
+/********************************************/
+int isJump ( int op )
+{ return (op >= opJLT) && (op <= opJNE) ;
+} /* isJump */
+
+/********************************************/
+/* comparison for sorting locations (or opcodes)
+ * by decreasing count, ties by increasing loc
+ */
+unsigned long * sortCounts;
+
+int cmpCount ( const void * a, const void * b )
+{ int x = *(const int *) a, y = *(const int *) b;
+  if ( sortCounts[x] != sortCounts[y] )
+    return sortCounts[x] < sortCounts[y] ? 1 : -1 ;
+  return x - y ;
+} /* cmpCount */
+
+/********************************************/
+double percent ( unsigned long n, unsigned long total )
+{ return total == 0 ? 0.0 : 100.0 * n / total ;
+} /* percent */
+
+/********************************************/
+/* source level counts, filled in by sumSource:
+ * instructions executed per source line and the
+ * instructions executed in each function itself
+ */
+unsigned long * srcLine = NULL;
+int * srcLineFunc = NULL;  /* function of each line */
+int srcLines = 0;          /* one past the highest line */
+unsigned long * funcSelf = NULL;
+
+/********************************************/
+char * funcName ( int f )
+{ return f < funcCount ? nameTab + funcTab[f].name : "(no function)" ;
+} /* funcName */
+
+/********************************************/
+/* sumSource adds the location counts up by
+ * source line and by function
+ */
+int sumSource (void)
+{ int e, loc, f;
+  while (callDepth > 0) profReturn () ; /* still running at the end */
+  for (e = 0 ; e < lineCount ; e++)
+    if (lineTab[e].line >= srcLines) srcLines = lineTab[e].line + 1 ;
+  srcLine = (unsigned long *) calloc(srcLines + 1, sizeof(unsigned long));
+  srcLineFunc = (int *) malloc((srcLines + 1) * sizeof(int));
+  funcSelf = (unsigned long *) calloc(funcCount + 1, sizeof(unsigned long));
+  if ( (srcLine == NULL) || (srcLineFunc == NULL) || (funcSelf == NULL) )
+    return FALSE;
+  for (e = 0 ; e < srcLines ; e++) srcLineFunc[e] = funcCount ;
+  for (e = 0 ; e < lineCount ; e++)
+    if ( (lineTab[e].line > 0) && (lineFunc[e] >= 0) )
+      srcLineFunc[lineTab[e].line] = lineFunc[e] ;
+  for (loc = 0 ; loc < iaddrSize ; loc++)
+    if (profExec[loc] > 0)
+    { e = lineEntry(loc) ;
+      if ( (e >= 0) && (lineTab[e].line > 0) )
+        srcLine[lineTab[e].line] += profExec[loc] ;
+      f = funcOf(loc) ;
+      funcSelf[f] += profExec[loc] ;
+    }
+  return TRUE;
+} /* sumSource */
+
+/********************************************/
+/* writeSourceReport adds the flat profile by
+ * line and function and the call graph to the
+ * hot-spot report
+ */
+void writeSourceReport ( FILE * f )
+{ unsigned long * incl;
+  int * order;
+  int n, k, c, fn, e;
+  order = (int *) malloc((srcLines + funcCount + 1) * sizeof(int));
+  incl = (unsigned long *) malloc((funcCount + 1) * sizeof(unsigned long));
+  if ( (order == NULL) || (incl == NULL) ) return;
+  fprintf(f,"\nSource lines\n");
+  fprintf(f," line        count       %%  function\n");
+  n = 0;
+  for (k = 1 ; k < srcLines ; k++)
+    if (srcLine[k] > 0) order[n++] = k ;
+  sortCounts = srcLine ;
+  qsort(order, n, sizeof(int), cmpCount);
+  for (k = 0 ; k < n ; k++)
+    fprintf(f,"%5d %12lu %6.2f%%  %s\n",order[k],srcLine[order[k]],
+            percent(srcLine[order[k]],profTotal),
+            funcName(srcLineFunc[order[k]]));
+
+  for (fn = 0 ; fn < funcCount ; fn++) incl[fn] = profFunc[fn].inclusive ;
+  incl[funcCount] = profTotal ;
+  for (fn = 0 ; fn <= funcCount ; fn++) order[fn] = fn ;
+  sortCounts = incl ;
+  qsort(order, funcCount + 1, sizeof(int), cmpCount);
+  fprintf(f,"\nFunctions\n");
+  fprintf(f,"function               calls         self       %%"
+            "    inclusive       %%\n");
+  for (k = 0 ; k <= funcCount ; k++)
+  { fn = order[k] ;
+    if ( (fn == funcCount) && (funcSelf[fn] == 0) ) continue;
+    fprintf(f,"%-16s %11lu %12lu %6.2f%% %12lu %6.2f%%\n",funcName(fn),
+            profFunc[fn].calls,funcSelf[fn],
+            percent(funcSelf[fn],profTotal),incl[fn],
+            percent(incl[fn],profTotal));
+  }
+
+  fprintf(f,"\nCall graph (callers indented below each function)\n");
+  fprintf(f,"function               calls    inclusive\n");
+  for (k = 0 ; k <= funcCount ; k++)
+  { fn = order[k] ;
+    if ( (fn == funcCount) || (profFunc[fn].calls == 0) ) continue;
+    fprintf(f,"%-16s %11lu %12lu\n",funcName(fn),
+            profFunc[fn].calls,incl[fn]);
+    for (c = 0 ; c <= funcCount ; c++)
+    { e = c * (funcCount + 1) + fn ;
+      if (profEdge[e].calls > 0)
+        fprintf(f,"    %-12s %11lu %12lu\n",funcName(c),
+                profEdge[e].calls,profEdge[e].inclusive);
+    }
+  }
+  free(incl);
+  free(order);
+} /* writeSourceReport */
+
+/********************************************/
+/* writeSourceCsv adds the line, function and
+ * call rows to the CSV file
+ */
+void writeSourceCsv ( FILE * f )
+{ int k, c, fn, e;
+  for (k = 1 ; k < srcLines ; k++)
+    if (srcLine[k] > 0)
+      fprintf(f,"line,%d,,%lu,,,,,%s,,,\n",k,srcLine[k],
+              funcName(srcLineFunc[k]));
+  for (fn = 0 ; fn < funcCount ; fn++)
+    fprintf(f,"func,%d,,%lu,,,,,%s,,%lu,%lu\n",funcTab[fn].entry,
+            funcSelf[fn],funcName(fn),profFunc[fn].calls,
+            profFunc[fn].inclusive);
+  for (fn = 0 ; fn < funcCount ; fn++)
+    for (c = 0 ; c <= funcCount ; c++)
+    { e = c * (funcCount + 1) + fn ;
+      if (profEdge[e].calls > 0)
+        fprintf(f,"call,%d,,,,,,,%s,%s,%lu,%lu\n",funcTab[fn].entry,
+                funcName(fn),funcName(c),profEdge[e].calls,
+                profEdge[e].inclusive);
+    }
+} /* writeSourceCsv */
+
+/********************************************/
+/* writeProfile writes the hot-spot report and
+ * the CSV file asked for on the command line
+ */
+void writeProfile (void)
+{ FILE * f;
+  int * order;
+  int n, k, loc, op;
+  int ranges = (daddrSize + PROF_RANGE - 1) / PROF_RANGE;
+  int source = (lineCount > 0);
+
+  order = (int *) malloc(iaddrSize * sizeof(int));
+  if ( (order == NULL) || (source && ! sumSource ()) )
+  { fprintf(stderr,"Out of memory writing profile\n");
+    return;
+  }
+  n = 0;
+  for (loc = 0 ; loc < iaddrSize ; loc++)
+    if ( profExec[loc] > 0 ) order[n++] = loc ;
+  sortCounts = profExec ;
+  qsort(order, n, sizeof(int), cmpCount);
+
+  if ( (profileFile != NULL) && ((f = fopen(profileFile,"w")) != NULL) )
+  { int ops[opRALim];
+    fprintf(f,"TM profile of %s: %lu instructions executed\n\n",
+            pgmName,profTotal);
+    fprintf(f,"Hot spots\n");
+    fprintf(f,"  loc        count       %%  instruction\n");
+    for (k = 0 ; (k < n) && (k < PROF_TOP) ; k++)
+    { loc = order[k] ;
+      fprintf(f,"%5d %12lu %6.2f%%  ",loc,profExec[loc],
+              percent(profExec[loc],profTotal));
+      printInstruction(f, loc);
+      fprintf(f,"\n");
+    }
+    fprintf(f,"\nOpcodes\n");
+    fprintf(f,"  op         count       %%\n");
+    for (op = 0 ; op < opRALim ; op++) ops[op] = op ;
+    sortCounts = profOps ;
+    qsort(ops, opRALim, sizeof(int), cmpCount);
+    for (k = 0 ; (k < opRALim) && (profOps[ops[k]] > 0) ; k++)
+      fprintf(f,"%-5s %12lu %6.2f%%\n",opCodeTab[ops[k]],
+              profOps[ops[k]],percent(profOps[ops[k]],profTotal));
+    fprintf(f,"\nBranches\n");
+    fprintf(f,"  loc   op      executed        taken    not taken  %%taken\n");
+    for (loc = 0 ; loc < iaddrSize ; loc++)
+      if ( (profExec[loc] > 0) && isJump(iMem[loc].iop) )
+        fprintf(f,"%5d %-5s %12lu %12lu %12lu %6.2f%%\n",loc,
+                opCodeTab[iMem[loc].iop],profExec[loc],profTaken[loc],
+                profExec[loc] - profTaken[loc],
+                percent(profTaken[loc],profExec[loc]));
+    fprintf(f,"\nData memory (ranges of %d words)\n",PROF_RANGE);
+    fprintf(f,"  first    last        loads       stores\n");
+    for (k = 0 ; k < ranges ; k++)
+      if ( (profLoads[k] > 0) || (profStores[k] > 0) )
+        fprintf(f,"%7d %7d %12lu %12lu\n",k * PROF_RANGE,
+                (k + 1) * PROF_RANGE - 1,profLoads[k],profStores[k]);
+    if (source) writeSourceReport(f);
+    fclose(f);
+  }
+  else if (profileFile != NULL)
+    fprintf(stderr,"Unable to open %s\n",profileFile);
+
+  if ( (profileCsv != NULL) && ((f = fopen(profileCsv,"w")) != NULL) )
+  { fprintf(f,"kind,loc,op,count,taken,nottaken,loads,stores,"
+              "function,caller,calls,inclusive\n");
+    for (k = 0 ; k < n ; k++)
+    { loc = order[k] ;
+      fprintf(f,"loc,%d,%s,%lu,",loc,opCodeTab[iMem[loc].iop],profExec[loc]);
+      if ( isJump(iMem[loc].iop) )
+        fprintf(f,"%lu,%lu,,,,,,\n",profTaken[loc],
+                profExec[loc] - profTaken[loc]);
+      else fprintf(f,",,,,,,,\n");
+    }
+    for (op = 0 ; op < opRALim ; op++)
+      if ( profOps[op] > 0 )
+        fprintf(f,"op,,%s,%lu,,,,,,,,\n",opCodeTab[op],profOps[op]);
+    for (k = 0 ; k < ranges ; k++)
+      if ( (profLoads[k] > 0) || (profStores[k] > 0) )
+        fprintf(f,"dmem,%d,,,,,%lu,%lu,,,,\n",k * PROF_RANGE,
+                profLoads[k],profStores[k]);
+    if (source) writeSourceCsv(f);
+    fclose(f);
+  }
+  else if (profileCsv != NULL)
+    fprintf(stderr,"Unable to open %s\n",profileCsv);
+  free(order);
+} /* writeProfile */
+
 /********************************************/
 int doCommand (void)
 { char cmd;
   int stepcnt=0, i;
   int printcnt;
   int stepResult;
-  int regNo, loc;
+  int regNo;
   do
   { printf ("Enter command: ");
     fflush (stdin);
@@ -440,6 +1410,9 @@ int doCommand (void)
       printf("   p(rint         "\
              "Toggle print of total instructions executed"\
              " ('go' only)\n");
+      printf("   f(ast          "\
+             "Toggle fast (pre-decoded) execution"\
+             " ('go' without trace only)\n");
       printf("   c(lear         "\
              "Reset simulator for new execution of program\n");
       printf("   h(elp          "\
@@ -455,6 +1428,13 @@ int doCommand (void)
       if ( icountflag ) printf("on.\n"); else printf("off.\n");
       break;
 
+    case 'f' :
+    /***********************************/
+      fastflag = ! fastflag ;
+      printf("Fast execution now ");
+      if ( fastflag ) printf("on.\n"); else printf("off.\n");
+      break;
+
     case 's' :
     /***********************************/
       if ( atEOL ())  stepcnt = 1;
@@ -482,7 +1462,7 @@ int doCommand (void)
       if ( ! atEOL ())
         printf ("Instruction locations?\n");
       else
-      { while ((iloc >= 0) && (iloc < IADDR_SIZE)
+      { while ((iloc >= 0) && (iloc < iaddrSize)
                 && (printcnt > 0) )
         { writeInstruction(iloc);
           iloc++ ;
@@ -501,7 +1481,7 @@ int doCommand (void)
       if ( ! atEOL ())
         printf("Data locations?\n");
       else
-      { while ((dloc >= 0) && (dloc < DADDR_SIZE)
+      { while ((dloc >= 0) && (dloc < daddrSize)
                   && (printcnt > 0))
         { printf("%5d: %5d\n",dloc,dMem[dloc]);
           dloc++;
@@ -517,9 +1497,10 @@ int doCommand (void)
       stepcnt = 0;
       for (regNo = 0;  regNo < NO_REGS ; regNo++)
             reg[regNo] = 0 ;
-      dMem[0] = DADDR_SIZE - 1 ;
-      for (loc = 1 ; loc < DADDR_SIZE ; loc++)
-            dMem[loc] = 0 ;
+      if ( ! clearData ())
+      { printf("Out of memory\n");
+        return FALSE;
+      }
       break;
 
     case 'q' : return FALSE;  /* break; */
@@ -528,12 +1509,19 @@ int doCommand (void)
   }  /* case */
   stepResult = srOKAY;
   if ( stepcnt > 0 )
-  { if ( cmd == 'g' )
+  { if ( (cmd == 'g') && fastflag && ! traceflag && ! profileflag )
+    { stepResult = runTM (&stepcnt);
+      if ( stepResult == srIMEM_ERR ) iloc = reg[PC_REG] ;
+      else iloc = reg[PC_REG] - 1 ;
+      if ( icountflag )
+        printf("Number of instructions executed = %d\n",stepcnt);
+    }
+    else if ( cmd == 'g' )
     { stepcnt = 0;
       while (stepResult == srOKAY)
       { iloc = reg[PC_REG] ;
         if ( traceflag ) writeInstruction( iloc ) ;
-        stepResult = stepTM ();
+        stepResult = profileflag ? profileStep () : stepTM ();
         stepcnt++;
       }
       if ( icountflag )
@@ -543,7 +1531,7 @@ int doCommand (void)
     { while ((stepcnt > 0) && (stepResult == srOKAY))
       { iloc = reg[PC_REG] ;
         if ( traceflag ) writeInstruction( iloc ) ;
-        stepResult = stepTM ();
+        stepResult = profileflag ? profileStep () : stepTM ();
         stepcnt-- ;
       }
     }
@@ -557,23 +1545,83 @@ int doCommand (void)
 /* E X E C U T I O N   B E G I N S   H E R E */
 /********************************************/
 
+/********************************************/
+void usage ( char * prog )
+{ printf("usage: %s [--fast] [--run] [--imem n] [--dmem n]\n"
+         "          [--profile report] [--profile-csv file] <filename>\n",
+         prog);
+  exit(1);
+} /* usage */
+
 main( int argc, char * argv[] )
-{ if (argc != 2)
-  { printf("usage: %s <filename>\n",argv[0]);
-    exit(1);
+{ int argn = 1;
+  int size;
+  while ( (argn < argc) && (argv[argn][0] == '-') )
+  { if ( strcmp(argv[argn],"--fast") == 0 ) fastflag = TRUE;
+    else if ( strcmp(argv[argn],"--run") == 0 ) batchflag = TRUE;
+    else if ( (strcmp(argv[argn],"--profile") == 0) && (argn + 1 < argc) )
+    { profileFile = argv[++argn];
+      profileflag = TRUE;
+    }
+    else if ( (strcmp(argv[argn],"--profile-csv") == 0) && (argn + 1 < argc) )
+    { profileCsv = argv[++argn];
+      profileflag = TRUE;
+    }
+    else if ( (strcmp(argv[argn],"--imem") == 0) && (argn + 1 < argc) )
+    { if ( (size = getSize(argv[++argn])) == 0 ) usage(argv[0]);
+      iaddrSize = size;
+      iaddrFixed = TRUE;
+    }
+    else if ( (strcmp(argv[argn],"--dmem") == 0) && (argn + 1 < argc) )
+    { if ( (size = getSize(argv[++argn])) == 0 ) usage(argv[0]);
+      daddrSize = size;
+      daddrFixed = TRUE;
+    }
+    else break;
+    argn++;
   }
-  strcpy(pgmName,argv[1]) ;
+  if ( (argn != argc - 1) || (strlen(argv[argn]) + 4 > FILENAME_MAX) )
+    usage(argv[0]);
+  strcpy(pgmName,argv[argn]) ;
   if (strchr (pgmName, '.') == NULL)
      strcat(pgmName,".tm");
-  pgm = fopen(pgmName,"r");
+  pgm = fopen(pgmName,"rb");
   if (pgm == NULL)
   { printf("file '%s' not found\n",pgmName);
     exit(1);
   }
 
   /* read the program */
-  if ( ! readInstructions ())
+  if ( isObject () ? ! loadObject () : ! readInstructions ())
          exit(1) ;
+  if ( (! decodeInstructions ()) || (profileflag && ! initProfile ()) )
+  { printf("Out of memory\n");
+    exit(1);
+  }
+  /* batch mode: run to completion with IN/OUT on
+   * stdin/stdout; the exit status is 0 after HALT,
+   * otherwise the STEPRESULT of the fault
+   */
+  if ( batchflag )
+  { int stepcnt;
+    STEPRESULT stepResult;
+    setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+    if ( profileflag )
+    { do stepResult = profileStep ();
+      while ( stepResult == srOKAY );
+      writeProfile ();
+    }
+    else stepResult = runTM (&stepcnt);
+    fflush(stdout);
+    if ( stepResult != srHALT )
+    { iloc = reg[PC_REG] ;
+      if ( stepResult != srIMEM_ERR ) iloc-- ;
+      fprintf(stderr,"%s: %s at %d\n",pgmName,
+              stepResultTab[stepResult],iloc);
+      return stepResult;
+    }
+    return 0;
+  }
   /* switch input file to terminal */
   /* reset( input ); */
   /* read-eval-print */
@@ -581,6 +1629,7 @@ main( int argc, char * argv[] )
   do
      done = ! doCommand ();
   while (! done );
+  if ( profileflag ) writeProfile ();
   printf("Simulation done.\n");
   return 0;
 }
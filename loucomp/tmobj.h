@@ -0,0 +1,104 @@
+/****************************************************/
+/* File: tmobj.h                                    */
+/* TM instruction set and binary object format,     */
+/* shared by the code emitter and the TM simulator  */
+/****************************************************/
+
+#ifndef _TMOBJ_H_
+#define _TMOBJ_H_
+
+typedef enum {
+   /* RR instructions */
+   opHALT,    /* RR     halt, operands are ignored */
+   opIN,      /* RR     read into reg(r); s and t are ignored */
+   opOUT,     /* RR     write from reg(r), s and t are ignored */
+   opADD,    /* RR     reg(r) = reg(s)+reg(t) */
+   opSUB,    /* RR     reg(r) = reg(s)-reg(t) */
+   opMUL,    /* RR     reg(r) = reg(s)*reg(t) */
+   opDIV,    /* RR     reg(r) = reg(s)/reg(t) */
+   opRRLim,   /* limit of RR opcodes */
+
+   /* RM instructions */
+   opLD,      /* RM     reg(r) = mem(d+reg(s)) */
+   opST,      /* RM     mem(d+reg(s)) = reg(r) */
+   opRMLim,   /* Limit of RM opcodes */
+
+   /* RA instructions */
+   opLDA,     /* RA     reg(r) = d+reg(s) */
+   opLDC,     /* RA     reg(r) = d ; reg(s) is ignored */
+   opJLT,     /* RA     if reg(r)<0 then reg(7) = d+reg(s) */
+   opJLE,     /* RA     if reg(r)<=0 then reg(7) = d+reg(s) */
+   opJGT,     /* RA     if reg(r)>0 then reg(7) = d+reg(s) */
+   opJGE,     /* RA     if reg(r)>=0 then reg(7) = d+reg(s) */
+   opJEQ,     /* RA     if reg(r)==0 then reg(7) = d+reg(s) */
+   opJNE,     /* RA     if reg(r)!=0 then reg(7) = d+reg(s) */
+   opRALim    /* Limit of RA opcodes */
+   } OPCODE;
+
+/* an instruction is stored as its opcode followed
+ * by r,s,t (RR) or r,d,s (RM and RA); an all-zero
+ * instruction is HALT 0,0,0
+ */
+typedef struct {
+      int iop  ;
+      int iarg1  ;
+      int iarg2  ;
+      int iarg3  ;
+   } INSTRUCTION;
+
+/**************************************************/
+/***********   Binary object image     ************/
+/**************************************************/
+
+/* An image is laid out as
+ *
+ *    header
+ *    line table    (lineCount TMOBJLINE entries)
+ *    name table    (nameSize bytes of '\0' ended names)
+ *    padding
+ *    code          (codeCount INSTRUCTIONs, locations
+ *                   0 to codeCount-1)
+ *
+ * in the native byte order of the machine that
+ * wrote it. The code comes last and starts on a
+ * TMOBJ_ALIGN boundary so that the simulator can
+ * map it directly from the file.
+ */
+
+/* "TMOB" read as a little-endian int; an image
+ * written on a machine of the other byte order
+ * fails this check
+ */
+#define TMOBJ_MAGIC    0x424F4D54
+#define TMOBJ_VERSION  1
+#define TMOBJ_ALIGN    4096
+
+typedef struct {
+      int magic ;
+      int version ;
+      int imemSize ;   /* requested sizes, 0 for default */
+      int dmemSize ;
+      int lineOffset ; /* file offset of the line table */
+      int lineCount ;
+      int nameOffset ; /* file offset of the name table */
+      int nameSize ;
+      int codeOffset ; /* file offset of the code */
+      int codeCount ;
+   } TMOBJHEADER;
+
+/* locations from loc up to the loc of the next entry
+ * were generated for source line line; name is the
+ * offset of the enclosing function name in the name
+ * table, or -1. The code of a function is contiguous
+ * and starts at its entry point, so the lowest loc
+ * carrying a name is the entry of that function.
+ * Text programs carry the same table as comment
+ * lines "*@ loc line name".
+ */
+typedef struct {
+      int loc ;
+      int line ;
+      int name ;
+   } TMOBJLINE;
+
+#endif
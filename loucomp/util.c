@@ -64,7 +64,7 @@ void printToken( TokenType token, const char* tokenString )
  * node for syntax tree construction
  */
 TreeNode * newStmtNode(StmtKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode * t = (TreeNode *) arenaAlloc(&TreeArena,sizeof(TreeNode));
   int i;
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
@@ -82,7 +82,7 @@ TreeNode * newStmtNode(StmtKind kind)
  * node for syntax tree construction
  */
 TreeNode * newExpNode(ExpKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode * t = (TreeNode *) arenaAlloc(&TreeArena,sizeof(TreeNode));
   int i;
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
@@ -98,7 +98,7 @@ TreeNode * newExpNode(ExpKind kind)
 }
 
 TreeNode * newDeclNode(DeclKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode * t = (TreeNode *) arenaAlloc(&TreeArena,sizeof(TreeNode));
   int i;
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
@@ -113,7 +113,7 @@ TreeNode * newDeclNode(DeclKind kind)
 }
 
 TreeNode * newParamNode(ParamKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode * t = (TreeNode *) arenaAlloc(&TreeArena,sizeof(TreeNode));
   int i;
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
@@ -128,7 +128,7 @@ TreeNode * newParamNode(ParamKind kind)
 }
 
 TreeNode * newTypeNode(TypeKind kind)
-{ TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode * t = (TreeNode *) arenaAlloc(&TreeArena,sizeof(TreeNode));
   int i;
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
@@ -142,15 +142,15 @@ TreeNode * newTypeNode(TypeKind kind)
   return t;
 }
 
-/* Function copyString allocates and makes a new
- * copy of an existing string
+/* Function copyString allocates (in TreeArena) and
+ * makes a new copy of an existing string
  */
 char * copyString(char * s)
 { int n;
   char * t;
   if (s==NULL) return NULL;
   n = strlen(s)+1;
-  t = malloc(n);
+  t = arenaAlloc(&TreeArena,n);
   if (t==NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
   else strcpy(t,s);
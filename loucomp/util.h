@@ -27,8 +27,8 @@ TreeNode * newDeclNode(DeclKind);
 TreeNode * newParamNode(ParamKind);
 TreeNode * newTypeNode(TypeKind);
 
-/* Function copyString allocates and makes a new
- * copy of an existing string
+/* Function copyString allocates (in TreeArena) and
+ * makes a new copy of an existing string
  */
 char * copyString(char *);
 
@@ -1378,7 +1378,7 @@ yyreduce:
 
   case 7:
 #line 50 "cminus.y" /* yacc.c:1646  */
-    { savedName = copyString(tokenString);
+    { savedName = tokenName;
                    savedLineNo = lineno;
                  }
 #line 1385 "y.tab.c" /* yacc.c:1646  */
@@ -1386,7 +1386,7 @@ yyreduce:
 
   case 8:
 #line 55 "cminus.y" /* yacc.c:1646  */
-    { savedNumber = atoi(tokenString);
+    { savedNumber = tokenValue;
                    savedLineNo = lineno;
                  }
 #line 1393 "y.tab.c" /* yacc.c:1646  */
@@ -1711,13 +1711,13 @@ yyreduce:
 
   case 47:
 #line 224 "cminus.y" /* yacc.c:1646  */
-    { (yyval) = GE; }
+    { (yyval) = GT; }
 #line 1716 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 48:
 #line 225 "cminus.y" /* yacc.c:1646  */
-    { (yyval) = GT; }
+    { (yyval) = GE; }
 #line 1722 "y.tab.c" /* yacc.c:1646  */
     break;
 
@@ -1810,7 +1810,7 @@ yyreduce:
   case 60:
 #line 265 "cminus.y" /* yacc.c:1646  */
     { (yyval) = newExpNode(ConstK);
-                   (yyval)->attr.val = atoi(tokenString);
+                   (yyval)->attr.val = tokenValue;
                    (yyval)->type = Integer;
                  }
 #line 1817 "y.tab.c" /* yacc.c:1646  */
@@ -2099,7 +2099,7 @@ yyreturn:
 int yyerror(char * message)
 { fprintf(listing,"Syntax error at line %d: %s\n",lineno,message);
   fprintf(listing,"Current token: ");
-  printToken(yychar,tokenString);
+  printToken(yychar,tokenText);
   Error = TRUE;
   return 0;
 }